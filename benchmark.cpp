@@ -0,0 +1,1419 @@
+// Copyright iorate 2015.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Micro-benchmarks of the hot paths. Build with optimization, e.g.
+//   g++ -std=c++14 -O2 -pthread benchmark.cpp -o benchmark
+//
+// With --getopt-long, compares the results and the time per argument with
+// those of getopt_long instead, where <getopt.h> is available. With --regex,
+// compares the classification of arguments with that of the regular
+// expressions getoptmm used before. With --check, runs the consistency
+// checks instead, best built with -fsanitize=address.
+
+// GCC sees uninitialized members in the states of std::regex, where built
+// with -fsanitize=address.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include "getoptmm.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <random>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__has_include)
+#  if __has_include(<getopt.h>)
+#    include <getopt.h>
+#    define GETOPTMM_BENCHMARK_GETOPT_LONG 1
+#  endif
+#endif
+
+namespace {
+
+std::atomic<std::size_t> g_allocs{0};
+
+} // unnamed namespace
+
+void *operator new(std::size_t n)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(n ? n : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// e.g. for the buffer of std::stable_sort, which is freed by the operator
+// delete below
+void *operator new(std::size_t n, std::nothrow_t const &) noexcept
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(n ? n : 1);
+}
+
+// GCC sees free called on a pointer from operator new, where both are the
+// replacements above and below.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+using namespace getoptmm;
+using clock_type = std::chrono::steady_clock;
+
+double g_min_seconds = 0.05;
+
+struct measurement
+{
+    double ns;
+    double allocs;
+};
+
+// Runs f repeatedly for at least g_min_seconds, and returns the cost per call.
+template <class F>
+measurement measure(F f)
+{
+    f(); // warm up
+    std::size_t n = 1;
+    for (;;) {
+        auto const allocs = g_allocs.load();
+        auto const start = clock_type::now();
+        for (std::size_t i = 0; i < n; ++i) {
+            f();
+        }
+        std::chrono::duration<double> const d = clock_type::now() - start;
+        if (d.count() >= g_min_seconds) {
+            return {d.count() * 1e9 / n, double(g_allocs.load() - allocs) / n};
+        }
+        n *= 2;
+    }
+}
+
+template <class String>
+String widen(std::string const &s)
+{
+    return String(s.begin(), s.end());
+}
+
+template <class String>
+char const *char_name();
+
+template <>
+char const *char_name<std::string>() { return "narrow"; }
+
+template <>
+char const *char_name<std::wstring>() { return "wide"; }
+
+enum class style_type
+{
+    short_option,
+    long_option,
+    separate,
+    abbreviated,
+    mixed
+};
+
+char const *style_name(style_type s)
+{
+    switch (s) {
+    case style_type::short_option: return "short";
+    case style_type::long_option: return "long";
+    case style_type::separate: return "separate";
+    case style_type::abbreviated: return "abbrev";
+    case style_type::mixed: return "mixed";
+    }
+    return "";
+}
+
+char short_name(std::size_t i)
+{
+    return "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"[i % 52];
+}
+
+std::string long_name(std::size_t i)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "opt-%04u-long-name", unsigned(i));
+    return buf;
+}
+
+// a unique prefix of long_name(i)
+std::string abbreviation(std::size_t i)
+{
+    return long_name(i).substr(0, 8);
+}
+
+template <class String, class T>
+struct fixture
+{
+    using char_type = typename String::value_type;
+    using option_type = basic_option<String>;
+    using parser_type = basic_parser<String>;
+
+    std::vector<T> values;
+    std::vector<String> non_options;
+    std::vector<option_type> options;
+
+    explicit fixture(std::size_t n)
+      : values(n)
+    {
+        auto const arg_name = widen<String>("ARG");
+        for (std::size_t i = 0; i < n; ++i) {
+            auto const name = widen<String>(long_name(i));
+            auto const description = widen<String>("description of ") + name;
+            // only the first 52 options have a short name
+            if (i < 52) {
+                options.emplace_back(
+                    std::initializer_list<char_type>{char_type(short_name(i))},
+                    std::initializer_list<String>{name},
+                    required_arg, assign(values[i]), arg_name, description);
+            } else {
+                options.emplace_back(
+                    std::initializer_list<char_type>{},
+                    std::initializer_list<String>{name},
+                    required_arg, assign(values[i]), arg_name, description);
+            }
+        }
+    }
+
+    parser_type make_parser()
+    {
+        return parser_type(options.begin(), options.end(), push_back(non_options));
+    }
+};
+
+template <class String>
+std::vector<String> make_args(
+    std::size_t options, std::size_t count, style_type style, bool numeric)
+{
+    std::mt19937 rng(42);
+    auto const value = numeric ? std::string("12345") : std::string("some-value-of-an-option");
+    std::vector<String> args;
+    while (args.size() < count) {
+        auto s = style;
+        if (s == style_type::mixed) {
+            s = static_cast<style_type>(rng() % 4);
+        }
+        auto const i = s == style_type::short_option ?
+            rng() % std::min<std::size_t>(options, 52) :
+            rng() % options;
+        switch (s) {
+        case style_type::short_option:
+            args.push_back(widen<String>(std::string("-") + short_name(i) + value));
+            break;
+        case style_type::long_option:
+            args.push_back(widen<String>("--" + long_name(i) + "=" + value));
+            break;
+        case style_type::separate:
+            args.push_back(widen<String>("--" + long_name(i)));
+            args.push_back(widen<String>(value));
+            break;
+        case style_type::abbreviated:
+            args.push_back(widen<String>("--" + abbreviation(i) + "=" + value));
+            break;
+        case style_type::mixed:
+            break;
+        }
+    }
+    return args;
+}
+
+template <class String, class T>
+void bench_run(std::size_t options, std::size_t argc, style_type style)
+{
+    using char_type = typename String::value_type;
+
+    fixture<String, T> f(options);
+    auto p = f.make_parser();
+    auto const args = make_args<String>(options, argc, style, std::is_arithmetic<T>::value);
+    std::vector<char_type const *> argv;
+    for (auto const &a : args) {
+        argv.push_back(a.c_str());
+    }
+    auto const m = measure([&] {
+        f.non_options.clear();
+        p.run(argv.begin(), argv.end());
+    });
+    std::printf(
+        "run          %-6s %-6s options=%-5u args=%-5u %-8s %8.1f ns/arg %6.2f allocs/parse\n",
+        char_name<String>(), std::is_arithmetic<T>::value ? "int" : "string",
+        unsigned(options), unsigned(argv.size()), style_name(style),
+        m.ns / argv.size(), m.allocs);
+}
+
+template <class String>
+void bench_construct(std::size_t options)
+{
+    fixture<String, int> f(options);
+    auto const m = measure([&] { f.make_parser(); });
+    std::printf(
+        "construct    %-6s        options=%-5u %10.0f ns %10.1f allocs\n",
+        char_name<String>(), unsigned(options), m.ns, m.allocs);
+}
+
+// A schema_parser over the schema of the options, instead of construct.
+void bench_schema(std::size_t options)
+{
+    fixture<std::string, int> f(options);
+    std::vector<unsigned char> bytes;
+    f.make_parser().save_schema(std::back_inserter(bytes));
+    std::vector<std::uint32_t> blob((bytes.size() + 3) / 4);
+    std::memcpy(blob.data(), bytes.data(), bytes.size());
+    auto const m = measure([&] {
+        schema const s(blob.data(), bytes.size());
+        make_schema_parser(s, [](std::size_t, string_view const *) {}, ignore);
+    });
+    std::printf(
+        "schema       narrow        options=%-5u %10.0f ns %10.1f allocs (%u bytes)\n",
+        unsigned(options), m.ns, m.allocs, unsigned(bytes.size()));
+}
+
+template <class String>
+void bench_usage_info(std::size_t options)
+{
+    fixture<String, int> f(options);
+    auto const header = widen<String>("usage: benchmark [OPTION...]");
+    auto const first = measure([&] { f.make_parser().usage_info(header); });
+    auto const p = f.make_parser();
+    auto const cached = measure([&] { p.usage_info(header); });
+    std::printf(
+        "usage_info   %-6s        options=%-5u %10.0f ns (construct + first) %10.0f ns (cached)\n",
+        char_name<String>(), unsigned(options), first.ns, cached.ns);
+}
+
+// As bench_run for mixed, split into record (into a reused parse_record) and
+// apply.
+template <class T>
+void bench_record(std::size_t options, std::size_t argc)
+{
+    fixture<std::string, T> f(options);
+    auto p = f.make_parser();
+    auto const args = make_args<std::string>(options, argc, style_type::mixed, std::is_arithmetic<T>::value);
+    std::vector<char const *> argv;
+    for (auto const &a : args) {
+        argv.push_back(a.c_str());
+    }
+    parse_record r;
+    auto const recorded = measure([&] { p.record(r, argv.begin(), argv.end()); });
+    auto const applied = measure([&] {
+        f.non_options.clear();
+        p.apply(r);
+    });
+    for (auto const &m : {std::make_pair("record", recorded), std::make_pair("apply", applied)}) {
+        std::printf(
+            "%-12s %-6s options=%-5u args=%-5u          %8.1f ns/arg %6.2f allocs/parse\n",
+            m.first, std::is_arithmetic<T>::value ? "int" : "string",
+            unsigned(options), unsigned(argv.size()), m.second.ns / argv.size(), m.second.allocs);
+    }
+}
+
+// As bench_run for mixed, with lazy values which are never read.
+template <class T>
+void bench_lazy(std::size_t options, std::size_t argc)
+{
+    std::vector<lazy_value<T>> values(options);
+    std::vector<getoptmm::option> opts;
+    for (std::size_t i = 0; i < options; ++i) {
+        auto const name = long_name(i);
+        if (i < 52) {
+            opts.emplace_back(
+                std::initializer_list<char>{short_name(i)}, std::initializer_list<std::string>{name},
+                required_arg, lazy(values[i]), "ARG", "description of " + name);
+        } else {
+            opts.emplace_back(
+                std::initializer_list<char>{}, std::initializer_list<std::string>{name},
+                required_arg, lazy(values[i]), "ARG", "description of " + name);
+        }
+    }
+    parser const p(opts.begin(), opts.end(), ignore);
+    auto const args = make_args<std::string>(
+        options, argc, style_type::mixed, std::is_arithmetic<T>::value);
+    std::vector<char const *> argv;
+    for (auto const &a : args) {
+        argv.push_back(a.c_str());
+    }
+    auto const m = measure([&] { p.run(argv.begin(), argv.end()); });
+    std::printf(
+        "run lazy     narrow %-6s options=%-5u args=%-5u %-8s %8.1f ns/arg %6.2f allocs/parse\n",
+        std::is_arithmetic<T>::value ? "int" : "string",
+        unsigned(options), unsigned(argv.size()), "mixed", m.ns / argv.size(), m.allocs);
+}
+
+// One option given argc times, with each occurrence_type.
+template <class T>
+void bench_occurrence(std::size_t argc)
+{
+    T value{};
+    auto const arg = std::string("-c") +
+        (std::is_arithmetic<T>::value ? "12345" : "some-value-of-an-option");
+    std::vector<char const *> argv(argc, arg.c_str());
+    for (auto o : {occurrence_type::accumulate, occurrence_type::first, occurrence_type::last}) {
+        getoptmm::option opts[] = {{{'c'}, {"count"}, required_arg, assign(value), "N", "count"}};
+        opts[0].set_occurrence(o);
+        parser const p(std::begin(opts), std::end(opts), ignore);
+        auto const m = measure([&] { p.run(argv.begin(), argv.end()); });
+        std::printf(
+            "occurrence   %-6s %-10s      args=%-5u          %8.1f ns/arg %6.2f allocs/parse\n",
+            std::is_arithmetic<T>::value ? "int" : "string",
+            o == occurrence_type::accumulate ? "accumulate" : o == occurrence_type::first ? "first" : "last",
+            unsigned(argc), m.ns / argc, m.allocs);
+    }
+}
+
+struct result
+{
+    std::vector<int> values;
+    std::vector<string_view> non_options;
+};
+
+// One parser shared by threads, each parsing into its own result.
+void bench_threads(std::size_t options, std::size_t argc)
+{
+    using option_type = basic_option<std::string, result>;
+
+    std::vector<option_type> opts;
+    for (std::size_t i = 0; i < options; ++i) {
+        auto const name = long_name(i);
+        auto const handler = by_view([i](result &r, string_view arg) {
+            detail::try_from_string(arg, r.values[i]);
+        });
+        if (i < 52) {
+            opts.emplace_back(
+                std::initializer_list<char>{short_name(i)}, std::initializer_list<std::string>{name},
+                required_arg, handler, "ARG", "description of " + name);
+        } else {
+            opts.emplace_back(
+                std::initializer_list<char>{}, std::initializer_list<std::string>{name},
+                required_arg, handler, "ARG", "description of " + name);
+        }
+    }
+    basic_parser<std::string, result> const p(
+        opts.begin(), opts.end(),
+        by_view([](result &r, string_view arg) { r.non_options.push_back(arg); }));
+
+    auto const args = make_args<std::string>(options, argc, style_type::mixed, true);
+    std::vector<char const *> argv;
+    for (auto const &a : args) {
+        argv.push_back(a.c_str());
+    }
+
+    double base = 0;
+    auto const max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned n = 1; ; n = std::min(n * 2, max_threads)) {
+        // each thread parses for about g_min_seconds
+        std::size_t const runs = std::max<std::size_t>(
+            1, static_cast<std::size_t>(g_min_seconds * 1e9 / (argv.size() * 100.0)));
+        std::vector<std::thread> threads;
+        auto const start = clock_type::now();
+        for (unsigned t = 0; t < n; ++t) {
+            threads.emplace_back([&] {
+                result r;
+                r.values.resize(options);
+                for (std::size_t k = 0; k < runs; ++k) {
+                    r.non_options.clear();
+                    p.run(r, argv.begin(), argv.end());
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        std::chrono::duration<double> const d = clock_type::now() - start;
+        auto const rate = n * runs * argv.size() / d.count();
+        if (n == 1) {
+            base = rate;
+        }
+        std::printf(
+            "threads      %-3u           options=%-5u args=%-5u %10.2f Margs/s %6.2fx\n",
+            n, unsigned(options), unsigned(argv.size()), rate / 1e6, rate / base);
+        if (n == max_threads) {
+            break;
+        }
+    }
+}
+
+// A large response file, read and split on each run.
+void bench_response_file(std::size_t options, std::size_t argc)
+{
+    fixture<std::string, std::string> f(options);
+    auto const p = fixture<std::string, std::string>::parser_type(
+        f.options.begin(), f.options.end(), push_back(f.non_options), parse_flag::response_files);
+    auto const path = "getoptmm-benchmark.rsp";
+    {
+        std::ofstream out(path);
+        for (auto const &a : make_args<std::string>(options, argc, style_type::mixed, false)) {
+            out << a << '\n';
+        }
+    }
+    std::string const arg = std::string("@") + path;
+    char const *argv[] = {arg.c_str()};
+    auto const m = measure([&] {
+        f.non_options.clear();
+        p.run(std::begin(argv), std::end(argv));
+    });
+    std::remove(path);
+    std::printf(
+        "response     file          options=%-5u args=%-7u %8.1f ns/arg\n",
+        unsigned(options), unsigned(argc), m.ns / argc);
+}
+
+// Many short argument vectors, by run in a loop and by parse_batch.
+void bench_batch(std::size_t options, std::size_t rows, std::size_t argc)
+{
+    fixture<std::string, int> f(options);
+    auto const p = f.make_parser();
+    auto const args = make_args<std::string>(options, rows * argc, style_type::mixed, true);
+    std::vector<std::vector<char const *>> batch(1);
+    for (auto const &a : args) {
+        // keep a separate argument with its option
+        if (batch.back().size() >= argc && a[0] == '-') {
+            batch.emplace_back();
+        }
+        batch.back().push_back(a.c_str());
+    }
+    auto const loop = measure([&] {
+        for (auto const &argv : batch) {
+            f.non_options.clear();
+            p.run(argv.begin(), argv.end());
+        }
+    });
+    std::printf(
+        "batch        run loop      options=%-5u rows=%-6u %8.1f ns/arg\n",
+        unsigned(options), unsigned(batch.size()), loop.ns / args.size());
+    auto const max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned n = 1; ; n = std::min(n * 2, max_threads)) {
+        auto const m = measure([&] { p.parse_batch(batch.begin(), batch.end(), n); });
+        std::printf(
+            "batch        threads=%-3u   options=%-5u rows=%-6u %8.1f ns/arg\n",
+            n, unsigned(options), unsigned(batch.size()), m.ns / args.size());
+        if (n == max_threads) {
+            break;
+        }
+    }
+}
+
+template <class T>
+void bench_from_string(char const *type, std::string const &value)
+{
+    string_view const v = value;
+    T sink{};
+    auto const m = measure([&] { sink = detail::from_string<T>(v); });
+    std::printf(
+        "from_string  %-6s %-26s %8.1f ns %6.2f allocs\n",
+        type, ("\"" + value + "\"").c_str(), m.ns, m.allocs);
+    static_cast<void>(sink);
+}
+
+// Options with handlers too large to be stored in place, moved as the vector
+// grows, into the parser and between parsers.
+bool check_large_handlers()
+{
+    std::vector<std::string> values(64);
+    std::vector<std::string> non_options;
+    std::vector<getoptmm::option> opts;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        char const padding[8 * sizeof(void *)] = {};
+        auto &v = values[i];
+        opts.emplace_back(
+            getoptmm::option::short_name_list{}, getoptmm::option::long_name_list{long_name(i)},
+            required_arg, [&v, padding](std::string const &arg) { v = arg + padding; }, "ARG", "");
+    }
+    parser p(std::make_move_iterator(opts.begin()), std::make_move_iterator(opts.end()), push_back(non_options));
+    auto q = p;
+    p = q;
+    q = std::move(p);
+    q.add_option(getoptmm::option({'x'}, {}, required_arg, assign(values[0]), "ARG", ""));
+    std::vector<std::string> const args = {"--" + long_name(3) + "=three", "-xzero", "--" + long_name(63), "last"};
+    q.run(args.begin(), args.end());
+    return values[0] == "zero" && values[3] == "three" && values[63] == "last" && non_options.empty();
+}
+
+struct check_context
+{
+    int n = 0;
+    std::vector<std::string> rest;
+};
+
+// An incremental parser of a parser with a Context.
+bool check_incremental_context()
+{
+    using context_parser = basic_parser<std::string, check_context>;
+    context_parser::option_type opts[] = {{{'n'}, {}, required_arg, assign(&check_context::n), "N", ""}};
+    context_parser const p(std::begin(opts), std::end(opts), push_back(&check_context::rest));
+    check_context c;
+    auto ip = make_incremental_parser(p, c);
+    ip.feed("-n1");
+    ip.feed("x");
+    ip.finish();
+    return c.n == 1 && c.rest.size() == 1;
+}
+
+// Occurrence policies across the arguments fed to an incremental parser.
+bool check_incremental_occurrence()
+{
+    int calls = 0;
+    std::string last;
+    getoptmm::option opts[] = {
+        getoptmm::option({'u'}, {}, no_arg, [&] { ++calls; }, "").set_occurrence(occurrence_type::unique),
+        getoptmm::option({'l'}, {}, required_arg, assign(last), "N", "").set_occurrence(occurrence_type::last)
+    };
+    parser const p(std::begin(opts), std::end(opts), ignore);
+    auto ip = make_incremental_parser(p);
+    ip.feed("-l1");
+    ip.feed("-l2");
+    ip.feed("-u");
+    auto duplicate = false;
+    try {
+        ip.feed("-u");
+    } catch (parser::error const &e) {
+        duplicate = e.type() == error_type::duplicate_option;
+    }
+    auto const before = last;
+    ip.finish();
+    return duplicate && calls == 1 && before.empty() && last == "2";
+}
+
+// The arguments fed after a subcommand go to the subcommand.
+bool check_incremental_command()
+{
+    auto top = false;
+    auto sub = false;
+    std::vector<std::string> files;
+    getoptmm::option opts[] = {{{'v'}, {}, no_arg, assign_true(top), ""}};
+    parser p(std::begin(opts), std::end(opts), ignore);
+    p.add_command("build", [&] {
+        getoptmm::option o[] = {{{'v'}, {}, no_arg, assign_true(sub), ""}};
+        return parser(std::begin(o), std::end(o), push_back(files));
+    });
+    auto ip = make_incremental_parser(p);
+    ip.feed("build");
+    ip.feed("-v");
+    ip.feed("file");
+    ip.finish();
+    return !top && sub && files.size() == 1;
+}
+
+// A schema whose hash table has no empty slot is rejected, rather than
+// probed forever.
+bool check_schema_slots()
+{
+    getoptmm::option opts[] = {{{}, {"name"}, no_arg, ignore, ""}};
+    std::vector<unsigned char> bytes;
+    parser(std::begin(opts), std::end(opts), ignore).save_schema(std::back_inserter(bytes));
+    std::vector<std::uint32_t> blob((bytes.size() + 3) / 4);
+    std::memcpy(blob.data(), bytes.data(), bytes.size());
+    if (!schema(blob.data(), bytes.size()).valid()) { return false; }
+    // fill every slot
+    auto const slots = blob.data() + detail::schema_header_size +
+        blob[detail::schema_option_count_field] + blob[detail::schema_short_count_field] * 2 +
+        blob[detail::schema_long_count_field] * 4;
+    std::fill(slots, slots + blob[detail::schema_slot_count_field], 0);
+    return !schema(blob.data(), bytes.size()).valid();
+}
+
+// Abbreviations of long names with bytes above 0x7f, which sort after the
+// others.
+bool check_non_ascii_names()
+{
+    std::vector<std::string> found;
+    getoptmm::option opts[] = {
+        {{}, {"alpha"}, no_arg, [&] { found.push_back("alpha"); }, ""},
+        {{}, {"\xc3\xa9t\xc3\xa9"}, no_arg, [&] { found.push_back("\xc3\xa9t\xc3\xa9"); }, ""}
+    };
+    parser const p(std::begin(opts), std::end(opts), ignore);
+    char const *argv[] = {"--alp", "--\xc3\xa9t"};
+    try {
+        p.run(std::begin(argv), std::end(argv));
+    } catch (parser::error const &) {
+        return false;
+    }
+    char const *words[] = {"--\xc3\xa9"};
+    auto const candidates = p.complete(std::begin(words), std::end(words));
+    return found == std::vector<std::string>{"alpha", "\xc3\xa9t\xc3\xa9"} &&
+        candidates.size() == 1 && candidates[0] == string_view("\xc3\xa9t\xc3\xa9");
+}
+
+// The same names in a schema.
+bool check_non_ascii_schema()
+{
+    getoptmm::option opts[] = {
+        {{'a'}, {"alpha"}, no_arg, ignore, ""},
+        {{'\xe9'}, {"\xc3\xa9t\xc3\xa9"}, no_arg, ignore, ""}
+    };
+    std::vector<unsigned char> bytes;
+    parser(std::begin(opts), std::end(opts), ignore).save_schema(std::back_inserter(bytes));
+    std::vector<std::uint32_t> blob((bytes.size() + 3) / 4);
+    std::memcpy(blob.data(), bytes.data(), bytes.size());
+    schema const s(blob.data(), bytes.size());
+    auto const abbreviation = [&](string_view name) {
+        auto const m = s.find_long(name.data(), name.data() + name.size());
+        return m.type == match_type::partial ? m.option : detail::no_index;
+    };
+    return s.valid() && s.find_short('a') == 0 && s.find_short('\xe9') == 1 &&
+        abbreviation("alp") == 0 && abbreviation("\xc3\xa9t") == 1;
+}
+
+// Lazy values of arguments read from a response file, used after the file
+// is released, and of arguments fed to an incremental parser.
+bool check_lazy_response_file()
+{
+    lazy_value<int> count;
+    lazy_values<std::string> libs;
+    getoptmm::option opts[] = {
+        {{'c'}, {}, required_arg, lazy(count), "N", ""},
+        {{'L'}, {}, required_arg, lazy(libs), "DIR", ""}
+    };
+    parser const p(std::begin(opts), std::end(opts), ignore, parse_flag::response_files);
+    auto const path = "getoptmm-check.rsp";
+    std::ofstream(path) << "-c 42 -Lfirst -L second\n";
+    char const *argv[] = {"@getoptmm-check.rsp"};
+    p.run(std::begin(argv), std::end(argv));
+    std::remove(path);
+    auto ok = count.get() == 42 && libs.get() == std::vector<std::string>{"first", "second"};
+    auto ip = make_incremental_parser(p);
+    for (auto a : {"-c", "7", "-Lthird"}) {
+        std::string token = a;
+        ip.feed(token);
+        token.assign(token.size(), '?');
+    }
+    ip.finish();
+    return ok && count.get() == 7 && libs.get().back() == "third";
+}
+
+// An asynchronous handler which reads its argument, a view into a response
+// file, after the parse of the file.
+bool check_async_response_file()
+{
+    std::string name;
+    getoptmm::option opts[] = {{{'o'}, {}, required_arg, by_view([&](string_view arg) {
+        return std::async(std::launch::async, [&name, arg] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            name.assign(arg.data(), arg.size());
+        });
+    }), "FILE", ""}};
+    parser const p(std::begin(opts), std::end(opts), ignore, parse_flag::response_files);
+    auto const path = "getoptmm-check.rsp";
+    std::ofstream(path) << "-o output\n";
+    char const *argv[] = {"@getoptmm-check.rsp"};
+    p.run(std::begin(argv), std::end(argv));
+    auto ok = name == "output";
+    name.clear();
+    auto ip = make_incremental_parser(p);
+    ip.feed("@getoptmm-check.rsp");
+    ip.finish();
+    std::remove(path);
+    return ok && name == "output";
+}
+
+// Runs p with the options of a config file of the given contents.
+void run_with_config_file(parser const &p, char const *contents)
+{
+    auto const path = "getoptmm-check.conf";
+    std::ofstream(path) << contents;
+    char const *argv[] = {"benchmark"};
+    p.run(std::begin(argv), std::end(argv), config_file_source(path));
+    std::remove(path);
+}
+
+// A lazy value of an option read from a config file, used after the run.
+bool check_config_file_lazy()
+{
+    lazy_value<int> count;
+    getoptmm::option opts[] = {{{}, {"count"}, required_arg, lazy(count), "N", ""}};
+    parser const p(std::begin(opts), std::end(opts), ignore);
+    run_with_config_file(p, "count = 42\n");
+    return count.get() == 42;
+}
+
+// An asynchronous handler which reads its argument, a view into a config
+// file, after the file has been read.
+bool check_config_file_async()
+{
+    std::string name;
+    getoptmm::option opts[] = {{{}, {"name"}, required_arg, by_view([&](string_view arg) {
+        return std::async(std::launch::async, [&name, arg] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            name.assign(arg.data(), arg.size());
+        });
+    }), "NAME", ""}};
+    parser const p(std::begin(opts), std::end(opts), ignore);
+    run_with_config_file(p, "name = output\n");
+    return name == "output";
+}
+
+// A run, and a lazy value converted, in a handler of try_run, which throw
+// rather than add to the errors of try_run.
+bool check_nested_errors()
+{
+    getoptmm::option inner_opts[] = {{{'v'}, {}, no_arg, ignore, ""}};
+    parser const inner(std::begin(inner_opts), std::end(inner_opts), ignore);
+    lazy_value<int> count;
+    auto run_thrown = false;
+    auto get_thrown = false;
+    getoptmm::option opts[] = {
+        {{'c'}, {}, required_arg, lazy(count), "N", ""},
+        {{'r'}, {}, no_arg, [&] {
+            char const *argv[] = {"-q"};
+            try {
+                inner.run(std::begin(argv), std::end(argv));
+            } catch (parser::error const &) {
+                run_thrown = true;
+            }
+        }, ""},
+        {{'g'}, {}, no_arg, [&] {
+            try {
+                count.get();
+            } catch (parser::error const &) {
+                get_thrown = true;
+            }
+        }, ""}
+    };
+    parser const p(std::begin(opts), std::end(opts), ignore);
+    char const *argv[] = {"-cx", "-r", "-g"};
+    auto const errors = p.try_run(std::begin(argv), std::end(argv));
+    return errors.empty() && run_thrown && get_thrown;
+}
+
+// The arguments of a row of a batch, which throws another error than a
+// parse error when it is read.
+struct throwing_row
+{
+    bool throws;
+
+    char const *const *begin() const
+    {
+        static char const *const args[] = {"-v"};
+        if (throws) { throw std::runtime_error("row"); }
+        return std::begin(args);
+    }
+
+    char const *const *end() const
+    {
+        return begin() + 1;
+    }
+};
+
+// parse_batch where a chunk throws, in the calling thread or in another.
+bool check_batch_exception()
+{
+    getoptmm::option opts[] = {{{'v'}, {}, no_arg, ignore, ""}};
+    parser const p(std::begin(opts), std::end(opts), ignore);
+    auto ok = true;
+    for (std::size_t k = 0; k < 4; ++k) {
+        std::vector<throwing_row> rows(4, throwing_row{false});
+        rows[k].throws = true;
+        try {
+            p.parse_batch(rows.begin(), rows.end(), 4);
+            ok = false;
+        } catch (std::runtime_error const &) {
+        }
+    }
+    std::vector<throwing_row> const rows(4, throwing_row{false});
+    return ok && p.parse_batch(rows.begin(), rows.end(), 4).options[0].rows.size() == 4;
+}
+
+int run_checks()
+{
+    auto failed = 0;
+    auto const check = [&](char const *name, bool ok) {
+        std::printf("check        %-40s %s\n", name, ok ? "ok" : "FAILED");
+        if (!ok) { ++failed; }
+    };
+    check("large handlers", check_large_handlers());
+    check("incremental with a context", check_incremental_context());
+    check("incremental occurrences", check_incremental_occurrence());
+    check("incremental subcommand", check_incremental_command());
+    check("schema slots", check_schema_slots());
+    check("non-ASCII long names", check_non_ascii_names());
+    check("non-ASCII names in a schema", check_non_ascii_schema());
+    check("lazy values of a response file", check_lazy_response_file());
+    check("asynchronous handlers of a response file", check_async_response_file());
+    check("lazy values of a config file", check_config_file_lazy());
+    check("asynchronous handlers of a config file", check_config_file_async());
+    check("errors in a handler of try_run", check_nested_errors());
+    check("exceptions in parse_batch", check_batch_exception());
+    return failed ? 1 : 0;
+}
+
+// An argument as classified by the tokenizer, or by the regular expressions
+// run used before it: the type, and the name and the value (if any).
+template <class String>
+struct classified
+{
+    detail::token_type type;
+    String name;
+    bool has_value;
+    String value;
+
+    bool operator==(classified const &other) const
+    {
+        return type == other.type && name == other.name &&
+            has_value == other.has_value && value == other.value;
+    }
+};
+
+template <class String>
+classified<String> classify_by_regex(String const &arg)
+{
+    using char_type = typename String::value_type;
+    using regex = std::basic_regex<char_type>;
+    static regex const long_option(GETOPTMM_LITERAL(char_type, "--([^=]*)(?:=(.*))?"));
+    static regex const short_option(GETOPTMM_LITERAL(char_type, "-(.+)"));
+    if (arg == GETOPTMM_LITERAL(char_type, "--")) {
+        return {detail::token_type::end_of_options, {}, false, {}};
+    }
+    std::match_results<typename String::const_iterator> m;
+    if (std::regex_match(arg, m, long_option)) {
+        return {detail::token_type::long_option, m.str(1), m[2].matched, m.str(2)};
+    }
+    if (std::regex_match(arg, m, short_option)) {
+        return {detail::token_type::short_option, m.str(1), false, {}};
+    }
+    return {detail::token_type::non_option, {}, false, {}};
+}
+
+template <class String>
+classified<String> classify_by_tokenizer(String const &arg)
+{
+    auto const t = detail::tokenize(arg.begin(), arg.end());
+    classified<String> c = {t.type, {}, t.has_value, {}};
+    if (t.type == detail::token_type::long_option || t.type == detail::token_type::short_option) {
+        c.name.assign(t.name_first, t.name_last);
+    }
+    if (t.has_value) { c.value.assign(t.value_first, t.value_last); }
+    return c;
+}
+
+template <class String>
+String random_argument(std::mt19937 &rng)
+{
+    using char_type = typename String::value_type;
+    // the characters the expressions treat specially, and some others
+    static char const atoms[] = {'-', '-', '-', '=', '=', 'v', 'o', '?', ' ', '\n', '\r', '\t'};
+    String s;
+    for (auto n = rng() % 7; n != 0; --n) {
+        s += char_type(atoms[rng() % sizeof(atoms)]);
+    }
+    return s;
+}
+
+// the characters of s, where all are ASCII
+template <class String>
+std::string narrow(String const &s)
+{
+    return std::string(s.begin(), s.end());
+}
+
+template <class String>
+void print_classified(char const *name, classified<String> const &c)
+{
+    static char const *const types[] = {"non-option", "end of options", "long option", "short option"};
+    std::printf("  %-10s %s", name, types[static_cast<int>(c.type)]);
+    if (c.type == detail::token_type::long_option || c.type == detail::token_type::short_option) {
+        std::printf(" \"%s\"", narrow(c.name).c_str());
+    }
+    if (c.has_value) { std::printf(" = \"%s\"", narrow(c.value).c_str()); }
+    std::printf("\n");
+}
+
+// Compares the classification of random arguments by the tokenizer with
+// that by the regular expressions, and returns the number of differences.
+template <class String>
+std::size_t compare_regex(std::size_t cases, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::size_t mismatches = 0;
+    for (std::size_t k = 0; k < cases; ++k) {
+        auto const arg = random_argument<String>(rng);
+        auto const expected = classify_by_regex(arg);
+        auto const actual = classify_by_tokenizer(arg);
+        if (actual == expected) { continue; }
+        if (++mismatches > 10) { continue; }
+        std::printf("mismatch: \"%s\"\n", narrow(arg).c_str());
+        print_classified("regex", expected);
+        print_classified("tokenizer", actual);
+    }
+    std::printf(
+        "regex        %-13s cases=%-7u seed=%-10u %u mismatches\n",
+        char_name<String>(), unsigned(cases), seed, unsigned(mismatches));
+    return mismatches;
+}
+
+#if GETOPTMM_BENCHMARK_GETOPT_LONG
+
+// An option table for both getoptmm and getopt_long.
+struct getopt_entry
+{
+    char short_name; // or 0
+    std::string long_name; // or empty
+    arg_type type;
+};
+
+using getopt_table = std::vector<getopt_entry>;
+
+// What a parser finds: the options in order, each as "i" or "i=ARG", the
+// non-options, and whether there is an error.
+struct getopt_result
+{
+    std::vector<std::string> options;
+    std::vector<std::string> non_options;
+    bool error = false;
+};
+
+// After an error, getoptmm stops and getopt_long goes on.
+bool operator==(getopt_result const &l, getopt_result const &r)
+{
+    return l.error == r.error &&
+        (l.error || (l.options == r.options && l.non_options == r.non_options));
+}
+
+std::string found(std::size_t i, char const *arg)
+{
+    auto s = std::to_string(i);
+    if (arg) {
+        s += '=';
+        s += arg;
+    }
+    return s;
+}
+
+struct found_handler
+{
+    std::vector<std::string> &options;
+    std::size_t i;
+
+    void operator()() const { options.push_back(found(i, nullptr)); }
+    void operator()(std::string const &arg) const { options.push_back(found(i, arg.c_str())); }
+};
+
+template <class Handler>
+parser make_getoptmm_parser(
+    getopt_table const &t, Handler make_handler, std::vector<std::string> &non_options, bool posix)
+{
+    std::vector<getoptmm::option> opts;
+    for (std::size_t i = 0; i < t.size(); ++i) {
+        getoptmm::option::short_name_list short_names;
+        getoptmm::option::long_name_list long_names;
+        if (t[i].short_name) { short_names.push_back(t[i].short_name); }
+        if (!t[i].long_name.empty()) { long_names.push_back(t[i].long_name); }
+        switch (t[i].type) {
+        case arg_type::none:
+            opts.emplace_back(std::move(short_names), std::move(long_names), no_arg, make_handler(i), "");
+            break;
+        case arg_type::optional:
+            opts.emplace_back(
+                std::move(short_names), std::move(long_names), optional_arg, make_handler(i), "ARG", "");
+            break;
+        case arg_type::required:
+            opts.emplace_back(
+                std::move(short_names), std::move(long_names), required_arg, make_handler(i), "ARG", "");
+            break;
+        }
+    }
+    return parser(
+        std::make_move_iterator(opts.begin()), std::make_move_iterator(opts.end()),
+        push_back(non_options), posix ? parse_flag::posixly_correct : parse_flag::none);
+}
+
+getopt_result run_getoptmm(getopt_table const &t, std::vector<std::string> const &args, bool posix)
+{
+    getopt_result r;
+    auto const p = make_getoptmm_parser(
+        t, [&](std::size_t i) { return found_handler{r.options, i}; }, r.non_options, posix);
+    try {
+        p.run(args.begin(), args.end());
+    } catch (parser::error const &) {
+        r.error = true;
+    }
+    return r;
+}
+
+struct getopt_long_table
+{
+    std::string short_options;
+    std::vector<::option> long_options;
+};
+
+getopt_long_table make_getopt_long_table(getopt_table const &t, bool posix)
+{
+    getopt_long_table g;
+    g.short_options = posix ? "+" : "";
+    for (std::size_t i = 0; i < t.size(); ++i) {
+        auto const colons = t[i].type == arg_type::none ? "" : t[i].type == arg_type::optional ? "::" : ":";
+        if (t[i].short_name) {
+            g.short_options += t[i].short_name;
+            g.short_options += colons;
+        }
+        if (!t[i].long_name.empty()) {
+            auto const has_arg = t[i].type == arg_type::none ? no_argument :
+                t[i].type == arg_type::optional ? optional_argument : required_argument;
+            g.long_options.push_back({t[i].long_name.c_str(), has_arg, nullptr, int(256 + i)});
+        }
+    }
+    g.long_options.push_back({nullptr, 0, nullptr, 0});
+    return g;
+}
+
+void reset_getopt_long()
+{
+    opterr = 0;
+#ifdef __GLIBC__
+    optind = 0;
+#else
+    optreset = 1;
+    optind = 1;
+#endif
+}
+
+// Calls f(i, optarg) for each option, and returns the index of the first
+// non-option after them, or -1 on an error.
+template <class F>
+int for_each_getopt_long(getopt_table const &t, getopt_long_table const &g, std::vector<char *> &argv, F f)
+{
+    reset_getopt_long();
+    auto const argc = int(argv.size()) - 1;
+    auto error = false;
+    for (;;) {
+        auto const c = getopt_long(argc, argv.data(), g.short_options.c_str(), g.long_options.data(), nullptr);
+        if (c == -1) { break; }
+        if (c == '?' || c == ':') {
+            error = true;
+            continue;
+        }
+        std::size_t i = 0;
+        if (c >= 256) { i = std::size_t(c - 256); }
+        else { while (t[i].short_name != c) { ++i; } }
+        f(i, t[i].type == arg_type::none ? nullptr : optarg);
+    }
+    return error ? -1 : optind;
+}
+
+getopt_result run_getopt_long(getopt_table const &t, getopt_long_table const &g, std::vector<std::string> args)
+{
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>("getopt_long"));
+    for (auto &a : args) { argv.push_back(&a[0]); }
+    argv.push_back(nullptr);
+    getopt_result r;
+    auto const end = for_each_getopt_long(t, g, argv, [&](std::size_t i, char const *arg) {
+        r.options.push_back(found(i, arg));
+    });
+    r.error = end < 0;
+    for (auto k = std::max(end, 1); k < int(argv.size()) - 1; ++k) { r.non_options.push_back(argv[k]); }
+    return r;
+}
+
+getopt_table random_getopt_table(std::mt19937 &rng)
+{
+    // prefixes of each other, and close to each other
+    static char const *const stems[] = {
+        "v", "ver", "verbose", "verbosity", "o", "out", "output", "output-dir", "x", "xx", "xxx",
+        "\xc3\xa9", "\xc3\xa9t\xc3\xa9"};
+    static arg_type const types[] = {arg_type::none, arg_type::optional, arg_type::required};
+    getopt_table t;
+    auto const n = 1 + rng() % 8;
+    for (std::size_t i = 0; i < n; ++i) {
+        getopt_entry e = {0, "", types[rng() % 3]};
+        if (rng() % 4 != 0) {
+            auto const c = "abcovx"[rng() % 6];
+            if (std::none_of(t.begin(), t.end(), [c](getopt_entry const &f) { return f.short_name == c; })) {
+                e.short_name = c;
+            }
+        }
+        if (rng() % 5 != 0) {
+            std::string s = stems[rng() % (sizeof(stems) / sizeof(*stems))];
+            if (rng() % 3 == 0) { s += char('0' + rng() % 3); }
+            if (std::none_of(t.begin(), t.end(), [&s](getopt_entry const &f) { return f.long_name == s; })) {
+                e.long_name = s;
+            }
+        }
+        if (e.short_name || !e.long_name.empty()) { t.push_back(e); }
+    }
+    return t;
+}
+
+std::vector<std::string> random_getopt_args(getopt_table const &t, std::mt19937 &rng)
+{
+    static char const *const words[] = {
+        "", "-", "--", "---", "a", "-a", "-ab", "-vo", "-o", "-ofile", "-x-", "--v", "--ve", "--verb",
+        "--output=", "--out=a", "--x=", "--xx", "--nope", "--=x", "-=", "file", "--\xc3", "--\xc3\xa9t"};
+    std::vector<std::string> args;
+    auto const n = rng() % 8;
+    for (std::size_t k = 0; k < n; ++k) {
+        if (t.empty() || rng() % 3 == 0) {
+            args.push_back(words[rng() % (sizeof(words) / sizeof(*words))]);
+            continue;
+        }
+        auto const &e = t[rng() % t.size()];
+        auto const &f = t[rng() % t.size()];
+        std::string const value = rng() % 4 == 0 ? "-v" : "val";
+        switch (rng() % 6) {
+        case 0: args.push_back(e.short_name ? std::string("-") + e.short_name : "-q"); break;
+        case 1: args.push_back(e.short_name ? std::string("-") + e.short_name + value : "-q"); break;
+        case 2: args.push_back(std::string("-") + (e.short_name ? e.short_name : 'q') + (f.short_name ? f.short_name : 'v')); break;
+        case 3: args.push_back("--" + e.long_name); break;
+        case 4: args.push_back("--" + e.long_name + "=" + value); break;
+        case 5: args.push_back("--" + e.long_name.substr(0, 1 + rng() % (e.long_name.size() + 1))); break;
+        }
+        if (rng() % 4 == 0) { args.push_back(value); }
+    }
+    return args;
+}
+
+void print_getopt_result(char const *name, getopt_result const &r)
+{
+    std::printf("  %-11s", name);
+    if (r.error) { std::printf(" error"); }
+    for (auto const &s : r.options) { std::printf(" [%s]", s.c_str()); }
+    std::printf(" |");
+    for (auto const &s : r.non_options) { std::printf(" \"%s\"", s.c_str()); }
+    std::printf("\n");
+}
+
+// Compares the results with those of getopt_long on random tables and
+// arguments, and returns the number of differences.
+std::size_t compare_getopt_long(std::size_t cases, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::size_t mismatches = 0;
+    for (std::size_t k = 0; k < cases; ++k) {
+        auto const t = random_getopt_table(rng);
+        auto const posix = rng() % 4 == 0;
+        auto const args = random_getopt_args(t, rng);
+        auto const expected = run_getopt_long(t, make_getopt_long_table(t, posix), args);
+        auto const actual = run_getoptmm(t, args, posix);
+        if (actual == expected) { continue; }
+        if (++mismatches > 10) { continue; }
+        std::printf("mismatch%s:", posix ? " (posixly_correct)" : "");
+        for (auto const &e : t) {
+            std::printf(
+                " %c/%s%s", e.short_name ? e.short_name : ' ', e.long_name.c_str(),
+                e.type == arg_type::none ? "" : e.type == arg_type::optional ? "[=ARG]" : "=ARG");
+        }
+        std::printf("\n  args       ");
+        for (auto const &a : args) { std::printf(" \"%s\"", a.c_str()); }
+        std::printf("\n");
+        print_getopt_result("getopt_long", expected);
+        print_getopt_result("getoptmm", actual);
+    }
+    std::printf(
+        "getopt_long  random        cases=%-7u seed=%-10u %u mismatches\n",
+        unsigned(cases), seed, unsigned(mismatches));
+    return mismatches;
+}
+
+enum class name_family
+{
+    // "option-with-a-common-prefix-N", given exactly
+    common_prefix,
+    // the same names abbreviated as much as possible
+    abbreviated,
+    // "x", "xx", "xxx"..., given exactly
+    prefix_chain
+};
+
+char const *family_name(name_family f)
+{
+    switch (f) {
+    case name_family::common_prefix: return "common-prefix";
+    case name_family::abbreviated: return "abbreviated";
+    case name_family::prefix_chain: return "prefix-chain";
+    }
+    return "";
+}
+
+// The time per argument of getoptmm and of getopt_long, and their growth
+// from the fewest options to the most. Returns whether getoptmm grows
+// faster, i.e. is asymptotically slower.
+bool compare_getopt_long_scaling(name_family f, std::size_t argc)
+{
+    double first[2] = {};
+    double last[2] = {};
+    auto const counts = {16u, 128u, 1024u};
+    for (auto n : counts) {
+        getopt_table t;
+        for (std::size_t i = 0; i < n; ++i) {
+            t.push_back({0, f == name_family::prefix_chain ?
+                std::string(i + 1, 'x') : "option-with-a-common-prefix-" + std::to_string(i),
+                arg_type::required});
+        }
+        std::vector<std::string> tokens(n);
+        for (std::size_t i = 0; i < n; ++i) { tokens[i] = t[i].long_name; }
+        if (f == name_family::abbreviated) {
+            // the shortest prefix which no other name has
+            std::vector<std::string> sorted(tokens);
+            std::sort(sorted.begin(), sorted.end());
+            for (auto &s : tokens) {
+                auto const it = std::lower_bound(sorted.begin(), sorted.end(), s);
+                std::size_t size = 0;
+                auto const common = [&](std::string const &o) {
+                    return std::size_t(std::mismatch(s.begin(), s.end(), o.begin(), o.end()).first - s.begin());
+                };
+                if (it != sorted.begin()) { size = std::max(size, common(*std::prev(it))); }
+                if (std::next(it) != sorted.end()) { size = std::max(size, common(*std::next(it))); }
+                s.resize(std::min(s.size(), size + 1));
+            }
+        }
+        std::mt19937 rng(42);
+        std::vector<std::string> args;
+        for (std::size_t k = 0; k < argc; ++k) {
+            args.push_back("--" + tokens[rng() % n] + "=value");
+        }
+
+        std::vector<std::string> non_options;
+        auto const p = make_getoptmm_parser(t, [](std::size_t) { return ignore; }, non_options, false);
+        auto const mm = measure([&] { p.run(args.begin(), args.end()); });
+
+        auto const g = make_getopt_long_table(t, false);
+        std::vector<char *> argv;
+        argv.push_back(const_cast<char *>("getopt_long"));
+        for (auto &a : args) { argv.push_back(&a[0]); }
+        argv.push_back(nullptr);
+        auto const original = argv;
+        std::size_t found = 0;
+        auto const gl = measure([&] {
+            // getopt_long may permute argv
+            std::copy(original.begin(), original.end(), argv.begin());
+            for_each_getopt_long(t, g, argv, [&](std::size_t, char const *) { ++found; });
+        });
+
+        std::printf(
+            "getopt_long  %-13s options=%-5u args=%-5u getoptmm %8.1f ns/arg  getopt_long %8.1f ns/arg\n",
+            family_name(f), n, unsigned(argc), mm.ns / argc, gl.ns / argc);
+        if (n == *counts.begin()) {
+            first[0] = mm.ns;
+            first[1] = gl.ns;
+        }
+        last[0] = mm.ns;
+        last[1] = gl.ns;
+        static_cast<void>(found);
+    }
+    auto const growth = last[0] / first[0];
+    auto const reference = last[1] / first[1];
+    // with a margin for noise
+    auto const slower = growth > 1.5 * std::max(reference, 1.0);
+    std::printf(
+        "getopt_long  %-13s growth: getoptmm %.1fx, getopt_long %.1fx%s\n",
+        family_name(f), growth, reference, slower ? "  ** asymptotically slower **" : "");
+    return slower;
+}
+
+#endif
+
+} // unnamed namespace
+
+int main(int argc, char *argv[])
+{
+    bool quick = false;
+    bool compare = false;
+    bool regex = false;
+    bool checks = false;
+    std::size_t cases = 100000;
+    unsigned seed = 1;
+    getoptmm::option opts[] = {
+        {{'q'}, {"quick"}, no_arg, assign_true(quick), "run each case briefly"},
+        {{'g'}, {"getopt-long"}, no_arg, assign_true(compare),
+            "compare with getopt_long on random inputs, and the growth of the time per argument"},
+        {{'r'}, {"regex"}, no_arg, assign_true(regex),
+            "compare the classification of random arguments with that of the former regular expressions"},
+        {{}, {"cases"}, required_arg, assign(cases), "N", "the number of random inputs (100000)"},
+        {{}, {"seed"}, required_arg, assign(seed), "N", "the seed of random inputs (1)"},
+        {{}, {"check"}, no_arg, assign_true(checks), "run the consistency checks"}
+    };
+    parser p(std::begin(opts), std::end(opts), ignore);
+    try {
+        p.run(argc, argv);
+    } catch (parser::error const &e) {
+        std::cerr << e.message() << "\n\n";
+        std::cout << p.usage_info("benchmark [OPTION...]") << '\n';
+        return 1;
+    }
+    if (quick) {
+        g_min_seconds = 0.005;
+    }
+    if (checks) {
+        return run_checks();
+    }
+    if (regex) {
+        auto const failed = compare_regex<std::string>(cases, seed) + compare_regex<std::wstring>(cases, seed);
+        return failed ? 1 : 0;
+    }
+    if (compare) {
+#if GETOPTMM_BENCHMARK_GETOPT_LONG
+        auto failed = compare_getopt_long(cases, seed) != 0;
+        for (auto f : {name_family::common_prefix, name_family::abbreviated, name_family::prefix_chain}) {
+            failed = compare_getopt_long_scaling(f, 256) || failed;
+        }
+        return failed ? 1 : 0;
+#else
+        static_cast<void>(cases);
+        static_cast<void>(seed);
+        std::cerr << "getopt_long is not available\n";
+        return 1;
+#endif
+    }
+
+    for (auto n : {10u, 100u, 1000u}) {
+        bench_construct<std::string>(n);
+        bench_construct<std::wstring>(n);
+        bench_schema(n);
+    }
+    for (auto n : {10u, 100u, 1000u}) {
+        bench_usage_info<std::string>(n);
+    }
+    for (auto n : {10u, 100u, 1000u}) {
+        for (auto argc : {16u, 1024u}) {
+            for (auto s : {
+                style_type::short_option, style_type::long_option,
+                style_type::separate, style_type::abbreviated, style_type::mixed}) {
+                bench_run<std::string, int>(n, argc, s);
+            }
+        }
+    }
+    for (auto s : {style_type::long_option, style_type::mixed}) {
+        bench_run<std::string, std::string>(100, 1024, s);
+        bench_run<std::wstring, int>(100, 1024, s);
+        bench_run<std::wstring, std::wstring>(100, 1024, s);
+    }
+    bench_lazy<int>(100, 1024);
+    bench_lazy<std::string>(100, 1024);
+    bench_record<int>(100, 1024);
+    bench_record<std::string>(100, 1024);
+    bench_occurrence<int>(1024);
+    bench_occurrence<std::string>(1024);
+    bench_threads(100, 1024);
+    bench_batch(100, 10000, 16);
+    bench_response_file(100, 1000000);
+    bench_from_string<int>("int", "12345");
+    bench_from_string<int>("int", "-2147483648");
+    bench_from_string<double>("double", "3.14159");
+    bench_from_string<double>("double", "1.7976931348623157e308");
+    bench_from_string<std::string>("string", "some-value-of-an-option");
+}
@@ -1,588 +1,6032 @@
-
-// Copyright iorate 2015.
-// Distributed under the Boost Software License, Version 1.0.
-// (See accompanying file LICENSE_1_0.txt or copy at
-// http://www.boost.org/LICENSE_1_0.txt)
-
-#ifndef GETOPTMM_HPP
-#define GETOPTMM_HPP
-
-#include <algorithm>
-#include <array>
-#include <cassert>
-#include <functional>
-#include <initializer_list>
-#include <iomanip>
-#include <iterator>
-#include <regex>
-#include <sstream>
-#include <stdexcept>
-#include <type_traits>
-#include <utility>
-#include <vector>
-
-namespace getoptmm {
-
-constexpr struct no_arg_t {} no_arg = {};
-constexpr struct optional_arg_t {} optional_arg = {};
-constexpr struct required_arg_t {} required_arg = {};
-
-enum class arg_type
-{
-    none,
-    optional,
-    required
-};
-
-enum class match_type
-{
-    none,
-    exact,
-    partial
-};
-
-template <class String>
-class basic_option
-{
-public:
-    using char_type = typename String::value_type;
-    using string_type = String;
-
-    template <class NoArgHandler>
-    basic_option(
-        std::initializer_list<char_type> short_names,
-        std::initializer_list<string_type> long_names,
-        no_arg_t,
-        NoArgHandler &&handler,
-        string_type const &description)
-      : m_short_names(short_names),
-        m_long_names(long_names),
-        m_arg_type(arg_type::none),
-        m_handler(
-            [h = std::forward<NoArgHandler>(handler)](string_type const *)
-            {
-                h();
-            }),
-        m_arg_name(),
-        m_description(description)
-    {}
-
-    template <class OptionalArgHandler>
-    basic_option(
-        std::initializer_list<char_type> short_names,
-        std::initializer_list<string_type> long_names,
-        optional_arg_t,
-        OptionalArgHandler &&handler,
-        string_type const &arg_name,
-        string_type const &description)
-      : m_short_names(short_names),
-        m_long_names(long_names),
-        m_arg_type(arg_type::optional),
-        m_handler(
-            [h = std::forward<OptionalArgHandler>(handler)](string_type const *a)
-            {
-                if (a) { h(*a); }
-                else { h(); }
-            }),
-        m_arg_name(arg_name),
-        m_description(description)
-    {}
-
-    template <class RequiredArgHandler>
-    basic_option(
-        std::initializer_list<char_type> short_names,
-        std::initializer_list<string_type> long_names,
-        required_arg_t,
-        RequiredArgHandler &&handler,
-        string_type const &arg_name,
-        string_type const &description)
-      : m_short_names(short_names),
-        m_long_names(long_names),
-        m_arg_type(arg_type::required),
-        m_handler(
-            [h = std::forward<RequiredArgHandler>(handler)](string_type const *a)
-            {
-                assert(a);
-                h(*a);
-            }),
-        m_arg_name(arg_name),
-        m_description(description)
-    {}
-
-    match_type match(char_type c) const
-    {
-        for (auto name : m_short_names) {
-            if (name == c) { return match_type::exact; }
-        }
-        return match_type::none;
-    }
-
-    match_type match(string_type const &s) const
-    {
-        auto ret = match_type::none;
-        for (auto const &name : m_long_names) {
-            if (name == s) { return match_type::exact; }
-            if (s.size() < name.size() &&
-                std::mismatch(s.begin(), s.end(), name.begin()).first == s.end()) {
-                ret = match_type::partial;
-            }
-        }
-        return ret;
-    }
-
-    arg_type get_arg_type() const noexcept
-    {
-        return m_arg_type;
-    }
-
-    void execute()
-    {
-        assert(m_arg_type != arg_type::required);
-        m_handler(nullptr);
-    }
-
-    void execute(string_type const &arg)
-    {
-        assert(m_arg_type != arg_type::none);
-        m_handler(&arg);
-    }
-
-    std::array<string_type, 3> usage_info() const
-    {
-        using ostringstream = std::basic_ostringstream<
-            char_type,
-            typename string_type::traits_type>;
-        std::array<string_type, 3> ret;
-        {
-            ostringstream oss;
-            auto first = true;
-            for (auto c : m_short_names) {
-                if (first) { first = false; }
-                else { oss << ','; }
-                oss << '-' << c;
-                if (m_arg_type == arg_type::optional) {
-                    oss << '[' << m_arg_name << ']';
-                }
-                else if (m_arg_type == arg_type::required) {
-                    oss << ' ' << m_arg_name;
-                }
-            }
-            ret[0] = oss.str();
-        }
-        {
-            ostringstream oss;
-            auto first = true;
-            for (auto const &s : m_long_names) {
-                if (first) { first = false; }
-                else { oss << ','; }
-                oss << "--" << s;
-                if (m_arg_type == arg_type::optional) {
-                    oss << "[=" << m_arg_name << ']';
-                } else if (m_arg_type == arg_type::required) {
-                    oss << '=' << m_arg_name;
-                }
-            }
-            ret[1] = oss.str();
-        }
-        ret[2] = m_description;
-        return ret;
-    }
-
-private:
-    std::vector<char_type> m_short_names;
-    std::vector<string_type> m_long_names;
-    arg_type m_arg_type;
-    std::function<void (string_type const *)> m_handler;
-    string_type m_arg_name;
-    string_type m_description;
-};
-
-using option = basic_option<std::string>;
-using woption = basic_option<std::wstring>;
-
-template <class String>
-class basic_parse_error
-  : public std::runtime_error
-{
-public:
-    using string_type = String;
-
-    explicit basic_parse_error(string_type const &message)
-      : std::runtime_error("parse error"),
-        m_message(message)
-    {}
-
-    string_type message() const
-    {
-        return m_message;
-    }
-
-private:
-    string_type m_message;
-};
-
-enum class parse_flag
-{
-    none,
-    posixly_correct
-};
-
-template <class String>
-class basic_parser
-{
-public:
-    using char_type = typename String::value_type;
-    using string_type = String;
-    using option_type = basic_option<String>;
-    using error = basic_parse_error<String>;
-
-    template <class Iterator, class NonOptionHandler>
-    basic_parser(
-        Iterator first, Iterator last,
-        NonOptionHandler &&non_option_handler,
-        parse_flag flag = parse_flag::none)
-      : basic_parser(
-          std::move(first), std::move(last),
-          std::forward<NonOptionHandler>(non_option_handler),
-          [](string_type const &a)
-          {
-              std::basic_stringstream<char_type, typename string_type::traits_type> err;
-              err << "unrecognized option: " << a;
-              throw error(err.str());
-          },
-          flag)
-    {}
-
-    template <
-        class Iterator, class NonOptionHandler, class UnrecOptionHandler,
-        std::result_of_t<UnrecOptionHandler(string_type const &)> * = nullptr>
-    basic_parser(
-        Iterator first, Iterator last,
-        NonOptionHandler &&non_option_handler,
-        UnrecOptionHandler &&unrec_option_handler,
-        parse_flag flag = parse_flag::none)
-      : m_options(std::move(first), std::move(last)),
-        m_non_option_handler(std::forward<NonOptionHandler>(non_option_handler)),
-        m_unrec_option_handler(std::forward<UnrecOptionHandler>(unrec_option_handler)),
-        m_flag(flag)
-    {}
-
-    void run(int argc, char_type **argv)
-    {
-        run(argv + 1, argv + argc);
-    }
-
-    template <class Iterator>
-    void run(Iterator first, Iterator last)
-    {
-        auto _ = [](char const *from)
-        {
-            std::basic_stringstream<char_type, typename string_type::traits_type> ss;
-            ss << from;
-            return ss.str();
-        };
-        for (auto it = first; it != last; ++it) {
-            string_type arg = *it;
-            if (arg == _("--")) {
-                // the rest are non-option
-                for (++it; it != last; ++it) {
-                    m_non_option_handler(*it);
-                }
-                break;
-            }
-            using regex = std::basic_regex<char_type>;
-            std::match_results<typename string_type::const_iterator> match;
-            if (std::regex_match(arg, match, regex(_("--([^=]*)(?:=(.*))?")))) {
-                // long option
-                auto const name = match.str(1);
-                auto find_match = [&](auto optit, match_type n) {
-                    return std::find_if(
-                        optit, m_options.end(),
-                        [&](auto const &opt) { return opt.match(name) == n; });
-                };
-                auto optit = find_match(m_options.begin(), match_type::exact);
-                if (optit == m_options.end()) {
-                    optit = find_match(m_options.begin(), match_type::partial);
-                    if (optit == m_options.end()) {
-                        m_unrec_option_handler(arg);
-                        continue;
-                    }
-                    if (find_match(std::next(optit), match_type::partial) != m_options.end()) {
-                        throw error(_("ambiguous option: --") + name);
-                    }
-                }
-                if (find_match(std::next(optit), match_type::exact) != m_options.end()) {
-                    throw error(_("ambiguous option: --") + name);
-                }
-                
-                auto const n = optit->get_arg_type();
-                if (n == arg_type::none) {
-                    if (match[2].matched) {
-                        throw error(_("argument not allowed: --") + name);
-                    }
-                    optit->execute();
-                } else if (n == arg_type::optional) {
-                    if (match[2].matched) {
-                        optit->execute(match[2]);
-                    } else {
-                        optit->execute();
-                    }
-                } else {
-                    if (match[2].matched) {
-                        optit->execute(match[2]);
-                    } else {
-                        if (++it == last) {
-                            throw error(_("argument required: --") + name);
-                        }
-                        optit->execute(*it);
-                    }
-                }
-            } else if (std::regex_match(arg, match, regex(_("-(.+)")))) {
-                // short option
-                for (auto cit = match[1].first, clast = match[1].second; cit != clast; ++cit) {
-                    auto name = *cit;
-                    auto find_match = [&](auto optit) {
-                        return std::find_if(
-                            optit, m_options.end(),
-                            [&](auto const &opt) { return opt.match(name) == match_type::exact; });
-                    };
-                    auto optit = find_match(m_options.begin());
-                    if (optit == m_options.end()) { 
-                        m_unrec_option_handler(_("-") + string_type(cit, clast));
-                        continue;
-                    }
-                    if (find_match(std::next(optit)) != m_options.end()) {
-                        throw error(_("ambiguous option: -") + name);
-                    }
-                    auto const n = optit->get_arg_type();
-                    if (n == arg_type::none) {
-                        optit->execute();
-                    } else if (n == arg_type::optional) {
-                        if (++cit == clast) { optit->execute(); }
-                        else { optit->execute({cit, clast}); }
-                        break;
-                    } else {
-                        if (++cit == clast) {
-                            if (++it == last) {
-                                throw error(_("argument required: -") + name);
-                            }
-                            optit->execute(*it);
-                        } else {
-                            optit->execute({cit, clast});
-                        }
-                        break;
-                    }
-                };
-            } else if (m_flag == parse_flag::posixly_correct) {
-                // non-option (the rest are treated as so)
-                for (; it != last; ++it) {
-                    m_non_option_handler(*it);
-                }
-                break;
-            } else {
-                // non-option
-                m_non_option_handler(*it);
-            }
-        }
-    }
-
-    string_type usage_info(string_type const &header) const
-    {
-        std::vector<std::array<string_type, 3>> helps;
-        helps.reserve(m_options.size());
-        auto col0 = 0;
-        auto col1 = 0;
-        for (auto const &opt: m_options) {
-            auto help = opt.usage_info();
-            col0 = std::max<int>(col0, help[0].length());
-            col1 = std::max<int>(col1, help[1].length());
-            helps.push_back(std::move(help));
-        }
-        ++col0;
-        ++col1;
-
-        using stringstream = std::basic_stringstream<
-            char_type,
-            typename string_type::traits_type>;
-        stringstream ss;
-        ss << header << '\n';
-        ss << std::left;
-        auto fstopt = true;
-        for (auto const &help: helps) {
-            if (fstopt) { fstopt = false; }
-            else { ss << '\n'; }
-
-            ss << std::setw(col0) << help[0];
-            ss << std::setw(col1) << help[1];
-            stringstream desc(help[2]);
-
-            string_type ln;
-            auto fstln = true;
-            while (std::getline(desc, ln)) {
-                if (fstln) { fstln = false; }
-                else { ss << '\n' << std::setw(col0 + col1) << ""; }
-                ss << ln;
-            }
-        }
-        return ss.str();
-    }
-
-private:
-    std::vector<option_type> m_options;
-    std::function<void (string_type const &)> m_non_option_handler;
-    std::function<void (string_type const &)> m_unrec_option_handler;
-    parse_flag m_flag;
-};
-
-using parser = basic_parser<std::string>;
-using wparser = basic_parser<std::wstring>;
-
-namespace detail {
-
-    template <class String, class T, bool = std::is_convertible<String const &, T>::value>
-    struct from_string_t
-    {
-        T operator()(String const &s) const
-        {
-            using stringstream = std::basic_stringstream<
-                typename String::value_type,
-                typename String::traits_type>;
-            using error = basic_parse_error<String>;
-
-            stringstream ss(s);
-            T t;
-            if (!(ss >> t && (ss.peek(), ss.eof()))) {
-                stringstream err;
-                err << "invalid value: " << s;
-                throw error(err.str());
-            }
-            return t;
-        }
-    };
-
-    template <class String, class T>
-    struct from_string_t<String, T, true>
-    {
-        T operator()(String const &s) const { return s; }
-    };
-
-    template <class T, class String>
-    inline T from_string(String const &s)
-    {
-        return from_string_t<String, T>()(s);
-    }
-
-    struct ignore_t
-    {
-        void operator()() const {}
-
-        template <class Arg>
-        void operator()(Arg const &) const {}
-    };
-
-    template <class T, class U>
-    struct assign_const_t
-    {
-        T &t;
-        U u;
-
-        void operator()() const { t = u; }
-
-        template <class Arg>
-        void operator()(Arg const &) const { t = u; }
-    };
-
-    template <class T, class U>
-    struct push_back_const_t
-    {
-        T &t;
-        U u;
-
-        void operator()() const { t.push_back(u); }
-
-        template <class Arg>
-        void operator()(Arg const &) const { t.push_back(u); }
-    };
-
-    template <class T, class U>
-    struct assign_or_t
-    {
-        T &t;
-        U u;
-
-        void operator()() const { t = u; }
-
-        template <class Arg>
-        void operator()(Arg const &arg) const { t = from_string<T>(arg); }
-    };
-
-    template <class T, class U>
-    struct push_back_or_t
-    {
-        T &t;
-        U u;
-
-        void operator()() const { t.push_back(u); }
-
-        template <class Arg>
-        void operator()(Arg const &arg) const
-        {
-            t.push_back(from_string<typename T::value_type>(arg));
-        }
-    };
-
-} // namespace detail
-
-constexpr detail::ignore_t ignore = {};
-
-template <class T, class U>
-inline auto assign_const(T &t, U &&u)
-{
-    return detail::assign_const_t<T, std::decay_t<U>>{t, std::forward<U>(u)};
-}
-
-template <class T>
-inline auto assign_true(T &t) { return detail::assign_const_t<T, bool>{t, true}; }
-
-template <class T>
-inline auto assign_false(T &t) { return detail::assign_const_t<T, bool>{t, false}; }
-
-template <class T, class U>
-inline auto push_back_const(T &t, U &&u)
-{
-    return detail::push_back_const_t<T, std::decay_t<U>>{t, std::forward<U>(u)};
-}
-
-template <class T, class U>
-inline auto assign_or(T &t, U &&u)
-{
-    return detail::assign_or_t<T, std::decay_t<U>>{t, std::forward<U>(u)};
-}
-
-template <class T, class U>
-inline auto push_back_or(T &t, U &&u)
-{
-    return detail::push_back_or_t<T, std::decay_t<U>>{t, std::forward<U>(u)};
-}
-
-template <class T>
-inline auto assign(T &t)
-{
-    return [&t](auto const &arg)
-    {
-        t = detail::from_string<T>(arg);
-    };
-}
-
-template <class T>
-inline auto push_back(T &t)
-{
-    return [&t](auto const &arg)
-    {
-        t.push_back(detail::from_string<typename T::value_type>(arg));
-    };
-}
-
-} // namespace getoptmm
-
-#endif
+
+// Copyright iorate 2015.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef GETOPTMM_HPP
+#define GETOPTMM_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <initializer_list>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef GETOPTMM_HAS_STD_STRING_VIEW
+#  if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#    define GETOPTMM_HAS_STD_STRING_VIEW 1
+#  else
+#    define GETOPTMM_HAS_STD_STRING_VIEW 0
+#  endif
+#endif
+
+#if GETOPTMM_HAS_STD_STRING_VIEW
+#include <string_view>
+#endif
+
+#ifndef GETOPTMM_HAS_EXCEPTIONS
+#  if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#    define GETOPTMM_HAS_EXCEPTIONS 1
+#  else
+#    define GETOPTMM_HAS_EXCEPTIONS 0
+#  endif
+#endif
+
+#ifndef GETOPTMM_INSTRUMENTATION
+#  define GETOPTMM_INSTRUMENTATION 0
+#endif
+
+#ifndef GETOPTMM_HAS_MMAP
+#  if defined(__unix__) || defined(__APPLE__)
+#    define GETOPTMM_HAS_MMAP 1
+#  else
+#    define GETOPTMM_HAS_MMAP 0
+#  endif
+#endif
+
+#ifndef GETOPTMM_HAS_SIMD
+#  if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || \
+     defined(__ARM_NEON)
+#    define GETOPTMM_HAS_SIMD 1
+#  else
+#    define GETOPTMM_HAS_SIMD 0
+#  endif
+#endif
+
+#if GETOPTMM_HAS_SIMD
+#  if defined(__ARM_NEON)
+#    include <arm_neon.h>
+#  else
+#    include <emmintrin.h>
+#  endif
+#endif
+
+#if GETOPTMM_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+#ifdef __cpp_char8_t
+#  define GETOPTMM_LITERAL_U8(s) , u8##s
+#else
+#  define GETOPTMM_LITERAL_U8(s)
+#endif
+
+// The string literal s of type Char const *, e.g. L"--" for wchar_t. The
+// literal is chosen at compile time, and nothing is converted at runtime.
+#define GETOPTMM_LITERAL(Char, s) \
+    (::getoptmm::detail::select_literal<Char>(s, L##s, u##s, U##s GETOPTMM_LITERAL_U8(s)))
+
+// The string literal s as String.
+#define GETOPTMM_STRING(String, s) (String(GETOPTMM_LITERAL(typename String::value_type, s)))
+
+#if defined(__APPLE__)
+#include <crt_externs.h>
+#elif !defined(_WIN32)
+extern char **environ;
+#endif
+
+namespace getoptmm {
+
+#if GETOPTMM_HAS_STD_STRING_VIEW
+
+template <class Char, class Traits = std::char_traits<Char>>
+using basic_string_view = std::basic_string_view<Char, Traits>;
+
+#else
+
+// A minimal substitute for std::basic_string_view.
+template <class Char, class Traits = std::char_traits<Char>>
+class basic_string_view
+{
+public:
+    using traits_type = Traits;
+    using value_type = Char;
+    using size_type = std::size_t;
+    using const_pointer = Char const *;
+    using const_iterator = Char const *;
+    using iterator = const_iterator;
+
+    constexpr basic_string_view() noexcept
+      : m_data(nullptr),
+        m_size(0)
+    {}
+
+    constexpr basic_string_view(Char const *s, size_type n) noexcept
+      : m_data(s),
+        m_size(n)
+    {}
+
+    basic_string_view(Char const *s)
+      : m_data(s),
+        m_size(Traits::length(s))
+    {}
+
+    template <class Allocator>
+    basic_string_view(std::basic_string<Char, Traits, Allocator> const &s) noexcept
+      : m_data(s.data()),
+        m_size(s.size())
+    {}
+
+    constexpr const_iterator begin() const noexcept { return m_data; }
+    constexpr const_iterator end() const noexcept { return m_data + m_size; }
+    constexpr const_pointer data() const noexcept { return m_data; }
+    constexpr size_type size() const noexcept { return m_size; }
+    constexpr size_type length() const noexcept { return m_size; }
+    constexpr bool empty() const noexcept { return m_size == 0; }
+    constexpr Char const &operator[](size_type i) const { return m_data[i]; }
+
+    int compare(basic_string_view s) const noexcept
+    {
+        auto const n = m_size < s.m_size ? m_size : s.m_size;
+        auto const ret = Traits::compare(m_data, s.m_data, n);
+        return ret != 0 ? ret : m_size < s.m_size ? -1 : m_size > s.m_size ? 1 : 0;
+    }
+
+    template <class Allocator>
+    explicit operator std::basic_string<Char, Traits, Allocator>() const
+    {
+        return {m_data, m_size};
+    }
+
+private:
+    Char const *m_data;
+    size_type m_size;
+};
+
+template <class Char, class Traits>
+inline bool operator==(basic_string_view<Char, Traits> l, basic_string_view<Char, Traits> r) noexcept
+{
+    return l.compare(r) == 0;
+}
+
+template <class Char, class Traits>
+inline bool operator!=(basic_string_view<Char, Traits> l, basic_string_view<Char, Traits> r) noexcept
+{
+    return l.compare(r) != 0;
+}
+
+template <class Char, class Traits>
+inline std::basic_ostream<Char, Traits> &operator<<(
+    std::basic_ostream<Char, Traits> &os, basic_string_view<Char, Traits> s)
+{
+    return os.write(s.data(), s.size());
+}
+
+#endif
+
+using string_view = basic_string_view<char>;
+using wstring_view = basic_string_view<wchar_t>;
+using u16string_view = basic_string_view<char16_t>;
+using u32string_view = basic_string_view<char32_t>;
+#ifdef __cpp_char8_t
+using u8string_view = basic_string_view<char8_t>;
+#endif
+
+namespace detail {
+
+    template <class...>
+    struct make_void { using type = void; };
+
+    template <class... Ts>
+    using void_t = typename make_void<Ts...>::type;
+
+    // Containers use the allocator of String, which is default-constructed.
+    template <class String, class T>
+    using rebind_alloc_t = typename std::allocator_traits<
+        typename String::allocator_type>::template rebind_alloc<T>;
+
+    template <class String, class T>
+    using vector_t = std::vector<T, rebind_alloc_t<String, T>>;
+
+    template <class String, class View>
+    inline String to_string(View s)
+    {
+        return String(s.data(), s.size());
+    }
+
+    template <class Char, class... Literals>
+    constexpr Char const *select_literal(Literals... literals)
+    {
+        return std::get<Char const *>(std::make_tuple(literals...));
+    }
+
+    // A handler which has a member type view_handler_tag takes an argument as
+    // basic_string_view, and others take it as String.
+    template <class Handler, class = void>
+    struct is_view_handler : std::false_type {};
+
+    template <class Handler>
+    struct is_view_handler<Handler, void_t<typename Handler::view_handler_tag>>
+      : std::true_type
+    {};
+
+    template <class String, class Handler, class View>
+    inline decltype(auto) call_with_arg(Handler &h, View arg, std::true_type)
+    {
+        return h(arg);
+    }
+
+    template <class String, class Handler, class View>
+    inline decltype(auto) call_with_arg(Handler &h, View arg, std::false_type)
+    {
+        return h(to_string<String>(arg));
+    }
+
+    template <class String, class Handler, class View>
+    inline decltype(auto) call_with_arg(Handler &h, View arg)
+    {
+        return call_with_arg<String>(h, arg, is_view_handler<std::remove_const_t<Handler>>());
+    }
+
+    template <class T>
+    struct is_future : std::false_type {};
+
+    template <class T>
+    struct is_future<std::future<T>> : std::true_type {};
+
+    inline std::future<void> to_void_future(std::future<void> f)
+    {
+        return f;
+    }
+
+    template <class T>
+    std::future<void> to_void_future(std::future<T> f)
+    {
+        return std::async(std::launch::deferred, [f = std::move(f)]() mutable { f.get(); });
+    }
+
+    // Calls f(), a handler, and returns the future it returns if it is
+    // asynchronous, or an empty one.
+    template <class F, std::enable_if_t<!is_future<decltype(std::declval<F &>()())>::value> * = nullptr>
+    std::future<void> handler_result(F f)
+    {
+        f();
+        return {};
+    }
+
+    template <class F, std::enable_if_t<is_future<decltype(std::declval<F &>()())>::value> * = nullptr>
+    std::future<void> handler_result(F f)
+    {
+        return to_void_future(f());
+    }
+
+    // the context of a parser without one
+    struct no_context {};
+
+    template <class Context>
+    using context_t = std::conditional_t<std::is_void<Context>::value, no_context, Context>;
+
+    // h(args...) called as h(context, args...)
+    template <class Handler, class Context>
+    struct context_bound_t
+    {
+        Handler &h;
+        Context &c;
+
+        template <class... Args>
+        decltype(auto) operator()(Args &&...args) const { return h(c, std::forward<Args>(args)...); }
+    };
+
+    template <class Handler, class Context, class = void>
+    struct context_bound : context_bound_t<Handler, Context>
+    {
+        context_bound(Handler &h, Context &c) : context_bound_t<Handler, Context>{h, c} {}
+    };
+
+    template <class Handler, class Context>
+    struct context_bound<Handler, Context, void_t<typename Handler::view_handler_tag>>
+      : context_bound_t<Handler, Context>
+    {
+        using view_handler_tag = void;
+
+        context_bound(Handler &h, Context &c) : context_bound_t<Handler, Context>{h, c} {}
+    };
+
+    template <class Handler, class Context>
+    inline context_bound<Handler, Context> bind_context(Handler &h, Context *c)
+    {
+        assert(c);
+        return {h, *c};
+    }
+
+    template <class Handler>
+    inline Handler &bind_context(Handler &h, no_context *)
+    {
+        return h;
+    }
+
+    template <class String, class Handler>
+    inline auto adapt_arg_handler(Handler &&h)
+    {
+        return [h = std::forward<Handler>(h)](auto *c, auto arg) mutable
+        {
+            auto &&b = bind_context(h, c);
+            call_with_arg<String>(b, arg);
+        };
+    }
+
+    // A copyable function wrapper like std::function, which stores a small
+    // callable (e.g. the handlers made by assign or push_back) in itself and
+    // allocates only for a larger one.
+    template <class Signature, std::size_t Size = 6 * sizeof(void *)>
+    class small_function;
+
+    template <class R, class... Args, std::size_t Size>
+    class small_function<R (Args...), Size>
+    {
+    public:
+        small_function() noexcept
+          : m_vtable(nullptr)
+        {}
+
+        template <
+            class F,
+            std::enable_if_t<!std::is_same<std::decay_t<F>, small_function>::value> * = nullptr>
+        small_function(F &&f)
+          : m_vtable(&model<std::decay_t<F>>::vtable)
+        {
+            model<std::decay_t<F>>::construct(m_storage, std::forward<F>(f));
+        }
+
+        small_function(small_function const &other)
+          : m_vtable(other.m_vtable)
+        {
+            if (m_vtable) { m_vtable->copy(other.m_storage, m_storage); }
+        }
+
+        small_function(small_function &&other) noexcept
+          : m_vtable(other.m_vtable)
+        {
+            if (m_vtable) {
+                m_vtable->move(other.m_storage, m_storage);
+                other.m_vtable = nullptr;
+            }
+        }
+
+        ~small_function()
+        {
+            if (m_vtable) { m_vtable->destroy(m_storage); }
+        }
+
+        small_function &operator=(small_function const &other)
+        {
+            if (this != &other) {
+                small_function tmp(other);
+                *this = std::move(tmp);
+            }
+            return *this;
+        }
+
+        small_function &operator=(small_function &&other) noexcept
+        {
+            if (this != &other) {
+                if (m_vtable) { m_vtable->destroy(m_storage); }
+                m_vtable = other.m_vtable;
+                if (m_vtable) {
+                    m_vtable->move(other.m_storage, m_storage);
+                    other.m_vtable = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return m_vtable != nullptr;
+        }
+
+        R operator()(Args... args) const
+        {
+            assert(m_vtable);
+            return m_vtable->invoke(m_storage, std::forward<Args>(args)...);
+        }
+
+    private:
+        struct storage_type
+        {
+            alignas(std::max_align_t) unsigned char data[Size];
+        };
+
+        struct vtable_type
+        {
+            R (*invoke)(storage_type &, Args &&...);
+            void (*copy)(storage_type const &, storage_type &);
+            // hands over the callable, after which from holds nothing
+            void (*move)(storage_type &, storage_type &) noexcept;
+            void (*destroy)(storage_type &) noexcept;
+        };
+
+        template <
+            class F,
+            bool = sizeof(F) <= sizeof(storage_type) &&
+                alignof(storage_type) % alignof(F) == 0 &&
+                std::is_nothrow_move_constructible<F>::value>
+        struct model
+        {
+            // stored in place
+            static F &get(storage_type &s) noexcept
+            {
+                return *reinterpret_cast<F *>(&s);
+            }
+
+            template <class G>
+            static void construct(storage_type &s, G &&g)
+            {
+                ::new (static_cast<void *>(&s)) F(std::forward<G>(g));
+            }
+
+            static R invoke(storage_type &s, Args &&...args)
+            {
+                return get(s)(std::forward<Args>(args)...);
+            }
+
+            static void copy(storage_type const &from, storage_type &to)
+            {
+                construct(to, get(const_cast<storage_type &>(from)));
+            }
+
+            static void move(storage_type &from, storage_type &to) noexcept
+            {
+                construct(to, std::move(get(from)));
+                destroy(from);
+            }
+
+            static void destroy(storage_type &s) noexcept
+            {
+                get(s).~F();
+            }
+
+            static constexpr vtable_type vtable = {&invoke, &copy, &move, &destroy};
+        };
+
+        template <class F>
+        struct model<F, false>
+        {
+            // allocated on the heap
+            static F *&get(storage_type &s) noexcept
+            {
+                return *reinterpret_cast<F **>(&s);
+            }
+
+            template <class G>
+            static void construct(storage_type &s, G &&g)
+            {
+                ::new (static_cast<void *>(&s)) F *(new F(std::forward<G>(g)));
+            }
+
+            static R invoke(storage_type &s, Args &&...args)
+            {
+                return (*get(s))(std::forward<Args>(args)...);
+            }
+
+            static void copy(storage_type const &from, storage_type &to)
+            {
+                construct(to, *get(const_cast<storage_type &>(from)));
+            }
+
+            static void move(storage_type &from, storage_type &to) noexcept
+            {
+                ::new (static_cast<void *>(&to)) F *(get(from));
+            }
+
+            static void destroy(storage_type &s) noexcept
+            {
+                delete get(s);
+            }
+
+            static constexpr vtable_type vtable = {&invoke, &copy, &move, &destroy};
+        };
+
+        mutable storage_type m_storage;
+        vtable_type const *m_vtable;
+    };
+
+    template <class R, class... Args, std::size_t Size>
+    template <class F, bool B>
+    constexpr typename small_function<R (Args...), Size>::vtable_type
+    small_function<R (Args...), Size>::model<F, B>::vtable;
+
+    template <class R, class... Args, std::size_t Size>
+    template <class F>
+    constexpr typename small_function<R (Args...), Size>::vtable_type
+    small_function<R (Args...), Size>::model<F, false>::vtable;
+
+    template <class Handler>
+    struct view_handler_t
+    {
+        using view_handler_tag = void;
+
+        Handler h;
+
+        // returns what h returns, e.g. the future of an asynchronous handler
+        template <class... Args>
+        decltype(auto) operator()(Args &&...args) const { return h(std::forward<Args>(args)...); }
+    };
+
+} // namespace detail
+
+// Makes a handler take an argument as basic_string_view, which refers to the
+// storage of the argument; e.g. argv. The argument is not copied.
+template <class Handler>
+inline auto by_view(Handler &&h)
+{
+    return detail::view_handler_t<std::decay_t<Handler>>{std::forward<Handler>(h)};
+}
+
+constexpr struct no_arg_t {} no_arg = {};
+constexpr struct optional_arg_t {} optional_arg = {};
+constexpr struct required_arg_t {} required_arg = {};
+
+enum class arg_type
+{
+    none,
+    optional,
+    required
+};
+
+// How basic_parser handles an option given more than once.
+enum class occurrence_type
+{
+    // the handler is called for each
+    accumulate,
+    // only for the first; the rest are ignored
+    first,
+    // only for the last, after the arguments are parsed
+    last,
+    // a second one is an error
+    unique
+};
+
+// the shells for which basic_parser::completion_script writes a script
+enum class shell_type
+{
+    bash,
+    zsh,
+    fish
+};
+
+enum class match_type
+{
+    none,
+    exact,
+    partial
+};
+
+namespace detail {
+
+    template <class String, class ShortNames, class LongNames, class ArgName>
+    std::array<String, 3> usage_info(
+        ShortNames const &short_names, LongNames const &long_names,
+        arg_type type, ArgName const &arg_name, String const &description)
+    {
+        using char_type = typename String::value_type;
+        std::array<String, 3> ret;
+        for (auto c : short_names) {
+            auto &s = ret[0];
+            if (!s.empty()) { s += char_type(','); }
+            s += char_type('-');
+            s += c;
+            if (type == arg_type::optional) {
+                s += char_type('[');
+                s.append(arg_name.data(), arg_name.size());
+                s += char_type(']');
+            }
+            else if (type == arg_type::required) {
+                s += char_type(' ');
+                s.append(arg_name.data(), arg_name.size());
+            }
+        }
+        for (auto const &name : long_names) {
+            auto &s = ret[1];
+            if (!s.empty()) { s += char_type(','); }
+            s.append(GETOPTMM_LITERAL(char_type, "--"));
+            s.append(name.data(), name.size());
+            if (type == arg_type::optional) {
+                s.append(GETOPTMM_LITERAL(char_type, "[="));
+                s.append(arg_name.data(), arg_name.size());
+                s += char_type(']');
+            } else if (type == arg_type::required) {
+                s += char_type('=');
+                s.append(arg_name.data(), arg_name.size());
+            }
+        }
+        ret[2] = description;
+        return ret;
+    }
+
+    template <class Char>
+    struct usage_counter
+    {
+        std::size_t size = 0;
+
+        void put(Char, std::size_t n = 1) { size += n; }
+        void append(Char const *, std::size_t n) { size += n; }
+    };
+
+    template <class String>
+    struct usage_appender
+    {
+        using char_type = typename String::value_type;
+
+        String &s;
+
+        void put(char_type c, std::size_t n = 1) { s.append(n, c); }
+        void append(char_type const *p, std::size_t n) { s.append(p, n); }
+    };
+
+    // Writes the option lines of a help text in three columns, the options
+    // of a group after those without one and after the heading of the group.
+    // A description longer than width - the first two columns is wrapped at
+    // spaces, unless width is 0 (or too small).
+    template <class String>
+    class usage_formatter
+    {
+    public:
+        using char_type = typename String::value_type;
+
+        // groups: empty, or the group of each of helps (nullptr or empty if
+        // none)
+        usage_formatter(
+            std::vector<std::array<String, 3>> const &helps,
+            std::vector<String const *> const &groups, std::size_t width)
+          : m_helps(helps), m_groups(groups), m_order(helps.size())
+        {
+            for (auto const &help : helps) {
+                m_col0 = std::max(m_col0, help[0].length());
+                m_col1 = std::max(m_col1, help[1].length());
+            }
+            ++m_col0;
+            ++m_col1;
+            m_wrap = width > m_col0 + m_col1 ? width - m_col0 - m_col1 : 0;
+
+            // groups in the order they first appear
+            std::vector<std::size_t> rank(helps.size());
+            std::vector<String const *> seen;
+            for (std::size_t i = 0; i < helps.size(); ++i) {
+                m_order[i] = i;
+                auto const g = group(i);
+                if (!g) { continue; }
+                auto it = std::find_if(
+                    seen.begin(), seen.end(), [g](auto const *h) { return *h == *g; });
+                rank[i] = static_cast<std::size_t>(it - seen.begin()) + 1;
+                if (it == seen.end()) { seen.push_back(g); }
+            }
+            if (!seen.empty()) {
+                std::stable_sort(
+                    m_order.begin(), m_order.end(),
+                    [&rank](std::size_t l, std::size_t r) { return rank[l] < rank[r]; });
+            }
+        }
+
+        template <class Out>
+        void write(Out &out) const
+        {
+            String const *prev = nullptr;
+            auto first = true;
+            for (auto i : m_order) {
+                auto const g = group(i);
+                if (g && (!prev || *prev != *g)) {
+                    if (!first) { out.put(char_type('\n'), 2); }
+                    out.append(g->data(), g->size());
+                    out.put(char_type('\n'));
+                }
+                else if (!first) { out.put(char_type('\n')); }
+                first = false;
+                prev = g;
+
+                auto const &help = m_helps[i];
+                out.append(help[0].data(), help[0].size());
+                out.put(char_type(' '), m_col0 - help[0].size());
+                out.append(help[1].data(), help[1].size());
+                out.put(char_type(' '), m_col1 - help[1].size());
+                write_description(out, help[2]);
+            }
+        }
+
+    private:
+        String const *group(std::size_t i) const
+        {
+            if (m_groups.empty() || !m_groups[i] || m_groups[i]->empty()) { return nullptr; }
+            return m_groups[i];
+        }
+
+        // line by line, as std::getline would read them
+        template <class Out>
+        void write_description(Out &out, String const &desc) const
+        {
+            auto const p = desc.data();
+            auto const n = desc.size();
+            for (std::size_t pos = 0; pos < n; ) {
+                auto end = pos;
+                while (end < n && p[end] != char_type('\n')) { ++end; }
+                if (pos != 0) {
+                    out.put(char_type('\n'));
+                    out.put(char_type(' '), m_col0 + m_col1);
+                }
+                if (m_wrap == 0) { out.append(p + pos, end - pos); }
+                else { write_wrapped(out, p + pos, p + end); }
+                pos = end + 1;
+            }
+        }
+
+        // words are not broken, and the spaces at a break are dropped
+        template <class Out>
+        void write_wrapped(Out &out, char_type const *first, char_type const *last) const
+        {
+            std::size_t col = 0;
+            while (first != last) {
+                auto const word = std::find_if(
+                    first, last, [](char_type c) { return c != char_type(' '); });
+                if (word == last) { break; }
+                auto const end = std::find(word, last, char_type(' '));
+                auto gap = static_cast<std::size_t>(word - first);
+                auto const size = static_cast<std::size_t>(end - word);
+                if (col != 0 && col + gap + size > m_wrap) {
+                    out.put(char_type('\n'));
+                    out.put(char_type(' '), m_col0 + m_col1);
+                    col = gap = 0;
+                }
+                out.put(char_type(' '), gap);
+                out.append(word, size);
+                col += gap + size;
+                first = end;
+            }
+        }
+
+        std::vector<std::array<String, 3>> const &m_helps;
+        std::vector<String const *> const &m_groups;
+        std::vector<std::size_t> m_order;
+        std::size_t m_col0 = 0;
+        std::size_t m_col1 = 0;
+        std::size_t m_wrap = 0;
+    };
+
+    // The lines are counted first and then written into one string of the
+    // size.
+    template <class String>
+    String format_usage(
+        std::vector<std::array<String, 3>> const &helps,
+        std::vector<String const *> const &groups = {}, std::size_t width = 0)
+    {
+        usage_formatter<String> f(helps, groups, width);
+        usage_counter<typename String::value_type> counter;
+        f.write(counter);
+        String ret;
+        ret.reserve(counter.size);
+        usage_appender<String> appender{ret};
+        f.write(appender);
+        return ret;
+    }
+
+    // The formatted option lines of a help text, built once on first use.
+    // A copy starts empty.
+    template <class String>
+    class usage_cache
+    {
+    public:
+        usage_cache() = default;
+        usage_cache(usage_cache const &) {}
+        usage_cache &operator=(usage_cache const &) { return *this; }
+
+        // not while get may be called
+        void reset()
+        {
+            m_body = String();
+            m_built.store(false, std::memory_order_relaxed);
+        }
+
+        template <class MakeBody>
+        String const &get(MakeBody make_body) const
+        {
+            if (!m_built.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_built.load(std::memory_order_relaxed)) {
+                    m_body = make_body();
+                    m_built.store(true, std::memory_order_release);
+                }
+            }
+            return m_body;
+        }
+
+    private:
+        mutable String m_body;
+        mutable std::atomic<bool> m_built{false};
+        mutable std::mutex m_mutex;
+    };
+
+    // A T made by factory() on the first call of get, once even if get is
+    // called concurrently. A copy makes its own.
+    template <class T>
+    class lazy_instance
+    {
+    public:
+        template <
+            class Factory,
+            std::enable_if_t<!std::is_same<std::decay_t<Factory>, lazy_instance>::value> * = nullptr>
+        explicit lazy_instance(Factory &&factory)
+          : m_factory(std::forward<Factory>(factory))
+        {}
+
+        lazy_instance(lazy_instance const &other)
+          : m_factory(other.m_factory)
+        {}
+
+        lazy_instance &operator=(lazy_instance const &other)
+        {
+            if (this != &other) {
+                m_factory = other.m_factory;
+                m_instance.reset();
+                m_built.store(false, std::memory_order_relaxed);
+            }
+            return *this;
+        }
+
+        T const &get() const
+        {
+            if (!m_built.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_built.load(std::memory_order_relaxed)) {
+                    m_instance.reset(new T(m_factory()));
+                    m_built.store(true, std::memory_order_release);
+                }
+            }
+            return *m_instance;
+        }
+
+        bool built() const
+        {
+            return m_built.load(std::memory_order_acquire);
+        }
+
+    private:
+        small_function<T ()> m_factory;
+        mutable std::unique_ptr<T> m_instance;
+        mutable std::atomic<bool> m_built{false};
+        mutable std::mutex m_mutex;
+    };
+
+    template <class OutputIterator, class String, class Body>
+    OutputIterator write_usage(OutputIterator out, String const &header, Body const &body)
+    {
+        out = std::copy(header.begin(), header.end(), out);
+        *out++ = typename String::value_type('\n');
+        return std::copy(body.begin(), body.end(), out);
+    }
+
+    template <class Char, class Traits, class String, class Body>
+    std::basic_ostream<Char, Traits> &write_usage(
+        std::basic_ostream<Char, Traits> &os, String const &header, Body const &body)
+    {
+        os.write(header.data(), header.size());
+        os.put(os.widen('\n'));
+        return os.write(body.data(), body.size());
+    }
+
+    template <class T>
+    using if_output_iterator_t = std::enable_if_t<!std::is_base_of<std::ios_base, T>::value>;
+
+} // namespace detail
+
+// With a Context, the handlers are called with the context given to
+// basic_parser::run as the first argument.
+template <class String, class Context = void>
+class basic_option
+{
+public:
+    using char_type = typename String::value_type;
+    using string_type = String;
+    using view_type = basic_string_view<char_type, typename string_type::traits_type>;
+    using context_type = detail::context_t<Context>;
+    using short_name_list = detail::vector_t<string_type, char_type>;
+    using long_name_list = detail::vector_t<string_type, string_type>;
+
+    // The names may also be given as short_name_list and long_name_list,
+    // which are moved from, as are the strings; names in braces are copied
+    // from the std::initializer_list.
+    template <class NoArgHandler>
+    basic_option(
+        std::initializer_list<char_type> short_names,
+        std::initializer_list<string_type> long_names,
+        no_arg_t,
+        NoArgHandler &&handler,
+        string_type description)
+      : basic_option(
+          short_name_list(short_names), long_name_list(long_names), no_arg,
+          std::forward<NoArgHandler>(handler), std::move(description))
+    {}
+
+    template <class OptionalArgHandler>
+    basic_option(
+        std::initializer_list<char_type> short_names,
+        std::initializer_list<string_type> long_names,
+        optional_arg_t,
+        OptionalArgHandler &&handler,
+        string_type arg_name,
+        string_type description)
+      : basic_option(
+          short_name_list(short_names), long_name_list(long_names), optional_arg,
+          std::forward<OptionalArgHandler>(handler), std::move(arg_name), std::move(description))
+    {}
+
+    template <class RequiredArgHandler>
+    basic_option(
+        std::initializer_list<char_type> short_names,
+        std::initializer_list<string_type> long_names,
+        required_arg_t,
+        RequiredArgHandler &&handler,
+        string_type arg_name,
+        string_type description)
+      : basic_option(
+          short_name_list(short_names), long_name_list(long_names), required_arg,
+          std::forward<RequiredArgHandler>(handler), std::move(arg_name), std::move(description))
+    {}
+
+    template <class NoArgHandler>
+    basic_option(
+        short_name_list short_names,
+        long_name_list long_names,
+        no_arg_t,
+        NoArgHandler &&handler,
+        string_type description)
+      : m_short_names(std::move(short_names)),
+        m_long_names(std::move(long_names)),
+        m_arg_type(arg_type::none),
+        m_handler(
+            [h = std::forward<NoArgHandler>(handler)](context_type *c, view_type const *) mutable
+            {
+                return detail::handler_result([&] { return detail::bind_context(h, c)(); });
+            }),
+        m_arg_name(),
+        m_description(std::move(description))
+    {}
+
+    template <class OptionalArgHandler>
+    basic_option(
+        short_name_list short_names,
+        long_name_list long_names,
+        optional_arg_t,
+        OptionalArgHandler &&handler,
+        string_type arg_name,
+        string_type description)
+      : m_short_names(std::move(short_names)),
+        m_long_names(std::move(long_names)),
+        m_arg_type(arg_type::optional),
+        m_handler(
+            [h = std::forward<OptionalArgHandler>(handler)](context_type *c, view_type const *a) mutable
+            {
+                auto &&b = detail::bind_context(h, c);
+                if (a) {
+                    return detail::handler_result([&] { return detail::call_with_arg<string_type>(b, *a); });
+                }
+                return detail::handler_result([&] { return b(); });
+            }),
+        m_arg_name(std::move(arg_name)),
+        m_description(std::move(description))
+    {}
+
+    template <class RequiredArgHandler>
+    basic_option(
+        short_name_list short_names,
+        long_name_list long_names,
+        required_arg_t,
+        RequiredArgHandler &&handler,
+        string_type arg_name,
+        string_type description)
+      : m_short_names(std::move(short_names)),
+        m_long_names(std::move(long_names)),
+        m_arg_type(arg_type::required),
+        m_handler(
+            [h = std::forward<RequiredArgHandler>(handler)](context_type *c, view_type const *a) mutable
+            {
+                assert(a);
+                auto &&b = detail::bind_context(h, c);
+                return detail::handler_result([&] { return detail::call_with_arg<string_type>(b, *a); });
+            }),
+        m_arg_name(std::move(arg_name)),
+        m_description(std::move(description))
+    {}
+
+    match_type match(char_type c) const
+    {
+        for (auto name : m_short_names) {
+            if (name == c) { return match_type::exact; }
+        }
+        return match_type::none;
+    }
+
+    match_type match(string_type const &s) const
+    {
+        auto ret = match_type::none;
+        for (auto const &name : m_long_names) {
+            if (name == s) { return match_type::exact; }
+            if (s.size() < name.size() &&
+                std::mismatch(s.begin(), s.end(), name.begin()).first == s.end()) {
+                ret = match_type::partial;
+            }
+        }
+        return ret;
+    }
+
+    short_name_list const &get_short_names() const noexcept
+    {
+        return m_short_names;
+    }
+
+    long_name_list const &get_long_names() const noexcept
+    {
+        return m_long_names;
+    }
+
+    arg_type get_arg_type() const noexcept
+    {
+        return m_arg_type;
+    }
+
+    occurrence_type get_occurrence() const noexcept
+    {
+        return m_occurrence;
+    }
+
+    string_type const &get_description() const noexcept
+    {
+        return m_description;
+    }
+
+    string_type const &get_group() const noexcept
+    {
+        return m_group;
+    }
+
+    basic_option &set_occurrence(occurrence_type occurrence) noexcept
+    {
+        m_occurrence = occurrence;
+        return *this;
+    }
+
+    // The heading under which the option is listed in the help message,
+    // e.g. "Output options:"; none if empty
+    basic_option &set_group(string_type group)
+    {
+        m_group = std::move(group);
+        return *this;
+    }
+
+    bool get_after_async() const noexcept
+    {
+        return m_after_async;
+    }
+
+    // The handler is called in run after the asynchronous handlers called
+    // before it have finished, e.g. one which uses what they fetch.
+    basic_option &set_after_async(bool after = true) noexcept
+    {
+        m_after_async = after;
+        return *this;
+    }
+
+    // Returns the future returned by the handler if it is asynchronous (it
+    // returns a std::future), or an empty one.
+    std::future<void> execute() const
+    {
+        assert(m_arg_type != arg_type::required);
+        return m_handler(nullptr, nullptr);
+    }
+
+    std::future<void> execute(view_type arg) const
+    {
+        assert(m_arg_type != arg_type::none);
+        return m_handler(nullptr, &arg);
+    }
+
+    std::future<void> execute(context_type &c) const
+    {
+        assert(m_arg_type != arg_type::required);
+        return m_handler(&c, nullptr);
+    }
+
+    std::future<void> execute(context_type &c, view_type arg) const
+    {
+        assert(m_arg_type != arg_type::none);
+        return m_handler(&c, &arg);
+    }
+
+    std::array<string_type, 3> usage_info() const
+    {
+        return detail::usage_info<string_type>(
+            m_short_names, m_long_names, m_arg_type, m_arg_name, m_description);
+    }
+
+private:
+    detail::vector_t<string_type, char_type> m_short_names;
+    detail::vector_t<string_type, string_type> m_long_names;
+    arg_type m_arg_type;
+    occurrence_type m_occurrence = occurrence_type::accumulate;
+    bool m_after_async = false;
+    detail::small_function<std::future<void> (context_type *, view_type const *)> m_handler;
+    string_type m_arg_name;
+    string_type m_description;
+    string_type m_group;
+};
+
+using option = basic_option<std::string>;
+using woption = basic_option<std::wstring>;
+
+enum class error_type
+{
+    unrecognized_option,
+    ambiguous_option,
+    argument_required,
+    argument_not_allowed,
+    invalid_value,
+    recursive_response_file,
+    duplicate_option,
+    // thrown by a user handler
+    other
+};
+
+template <class String>
+class basic_parse_error
+  : public std::runtime_error
+{
+public:
+    using string_type = String;
+
+    explicit basic_parse_error(string_type const &message)
+      : basic_parse_error(error_type::other, message)
+    {}
+
+    basic_parse_error(error_type type, string_type const &message)
+      : std::runtime_error("parse error"),
+        m_type(type),
+        m_message(message)
+    {}
+
+    error_type type() const
+    {
+        return m_type;
+    }
+
+    string_type message() const
+    {
+        return m_message;
+    }
+
+private:
+    error_type m_type;
+    string_type m_message;
+};
+
+// An error collected by try_run.
+template <class String>
+struct basic_error_info
+{
+    error_type type;
+    // the argument in which the error is found
+    String token;
+    // the position of the argument (in argv for try_run(argc, argv))
+    std::size_t index;
+    String message;
+};
+
+using error_info = basic_error_info<std::string>;
+using werror_info = basic_error_info<std::wstring>;
+
+namespace detail {
+
+    template <class String>
+    struct error_sink
+    {
+        vector_t<String, basic_error_info<String>> &errors;
+        std::size_t index;
+        // the argument being parsed
+        basic_string_view<typename String::value_type, typename String::traits_type> token;
+    };
+
+    // the errors being collected on this thread, if any
+    template <class String>
+    inline error_sink<String> *&current_error_sink()
+    {
+        static thread_local error_sink<String> *s = nullptr;
+        return s;
+    }
+
+    // Makes the errors reported in the scope go to sink, or be thrown if it
+    // is null; e.g. those of a run in a handler of try_run are thrown.
+    template <class String>
+    struct error_sink_scope
+    {
+        error_sink<String> *saved = current_error_sink<String>();
+
+        explicit error_sink_scope(error_sink<String> *sink) { current_error_sink<String>() = sink; }
+        ~error_sink_scope() { current_error_sink<String>() = saved; }
+        error_sink_scope(error_sink_scope const &) = delete;
+        error_sink_scope &operator=(error_sink_scope const &) = delete;
+    };
+
+    // Whether the arguments being parsed on this thread may be gone after
+    // the parse (those of a response file or a config file, or fed to an
+    // incremental parser), so that a handler which keeps a view of one must
+    // copy it.
+    inline bool &transient_arguments()
+    {
+        static thread_local bool b = false;
+        return b;
+    }
+
+    struct transient_scope
+    {
+        bool saved = transient_arguments();
+
+        transient_scope() { transient_arguments() = true; }
+        ~transient_scope() { transient_arguments() = saved; }
+        transient_scope(transient_scope const &) = delete;
+        transient_scope &operator=(transient_scope const &) = delete;
+    };
+
+    // Throws basic_parse_error, or records the error if try_run is
+    // collecting them (then the caller goes on to the next argument).
+    template <class String>
+    void report_error(error_type type, String message)
+    {
+        if (auto const sink = current_error_sink<String>()) {
+            sink->errors.push_back(
+                {type, to_string<String>(sink->token), sink->index, std::move(message)});
+            return;
+        }
+#if GETOPTMM_HAS_EXCEPTIONS
+        throw basic_parse_error<String>(type, message);
+#else
+        std::abort();
+#endif
+    }
+
+    template <class Char, class Traits>
+    using invalid_value_reporter = void (*)(basic_string_view<Char, Traits>);
+
+    // The converters of views only know the character type, and report
+    // errors as std::basic_string<Char, Traits> unless a parser of another
+    // String sets this while it is parsing.
+    template <class Char, class Traits>
+    inline invalid_value_reporter<Char, Traits> &current_invalid_value_reporter()
+    {
+        static thread_local invalid_value_reporter<Char, Traits> r = nullptr;
+        return r;
+    }
+
+    template <class String>
+    void report_invalid_value_as(
+        basic_string_view<typename String::value_type, typename String::traits_type> s)
+    {
+        String message = GETOPTMM_STRING(String, "invalid value: ");
+        message.append(s.data(), s.size());
+        report_error(error_type::invalid_value, std::move(message));
+    }
+
+    template <class Char, class Traits>
+    void report_invalid_value(basic_string_view<Char, Traits> s)
+    {
+        if (auto const r = current_invalid_value_reporter<Char, Traits>()) {
+            r(s);
+            return;
+        }
+        report_invalid_value_as<std::basic_string<Char, Traits>>(s);
+    }
+
+    // Sets current_invalid_value_reporter for a parser of String.
+    template <class String, bool = std::is_same<String,
+        std::basic_string<typename String::value_type, typename String::traits_type>>::value>
+    struct invalid_value_scope
+    {
+        using char_type = typename String::value_type;
+        using traits_type = typename String::traits_type;
+
+        invalid_value_reporter<char_type, traits_type> outer =
+            current_invalid_value_reporter<char_type, traits_type>();
+
+        invalid_value_scope()
+        {
+            current_invalid_value_reporter<char_type, traits_type>() = &report_invalid_value_as<String>;
+        }
+
+        invalid_value_scope(invalid_value_scope const &) = delete;
+        invalid_value_scope &operator=(invalid_value_scope const &) = delete;
+
+        ~invalid_value_scope()
+        {
+            current_invalid_value_reporter<char_type, traits_type>() = outer;
+        }
+    };
+
+    template <class String>
+    struct invalid_value_scope<String, true>
+    {
+        invalid_value_scope() {}
+    };
+
+    // Makes an invalid value converted in the scope be thrown as an error of
+    // std::basic_string<Char, Traits>, even in a handler of a parser.
+    template <class Char, class Traits>
+    struct throwing_conversion_scope
+    {
+        error_sink_scope<std::basic_string<Char, Traits>> sink{nullptr};
+        invalid_value_reporter<Char, Traits> outer = current_invalid_value_reporter<Char, Traits>();
+
+        throwing_conversion_scope() { current_invalid_value_reporter<Char, Traits>() = nullptr; }
+        ~throwing_conversion_scope() { current_invalid_value_reporter<Char, Traits>() = outer; }
+        throwing_conversion_scope(throwing_conversion_scope const &) = delete;
+        throwing_conversion_scope &operator=(throwing_conversion_scope const &) = delete;
+    };
+
+    // Calls f() collecting the errors it reports, starting from index.
+    template <class String, class F>
+    vector_t<String, basic_error_info<String>> collect_errors(std::size_t index, F f)
+    {
+        vector_t<String, basic_error_info<String>> errors;
+        error_sink<String> sink = {errors, index, {}};
+        error_sink_scope<String> scope(&sink);
+        f();
+        return errors;
+    }
+
+} // namespace detail
+
+namespace detail {
+
+    enum class token_type
+    {
+        non_option,
+        end_of_options,
+        long_option,
+        short_option
+    };
+
+    template <class Iterator>
+    struct token
+    {
+        token_type type;
+        Iterator name_first;
+        Iterator name_last;
+        bool has_value;
+        Iterator value_first;
+        Iterator value_last;
+    };
+
+    template <class Char>
+    constexpr bool is_line_terminator(Char c)
+    {
+        return c == Char('\n') || c == Char('\r');
+    }
+
+    template <class Char>
+    constexpr bool is_space(Char c)
+    {
+        return c == Char(' ') || (Char('\t') <= c && c <= Char('\r'));
+    }
+
+    template <class Char>
+    constexpr bool is_digit(Char c)
+    {
+        return Char('0') <= c && c <= Char('9');
+    }
+
+#if GETOPTMM_HAS_SIMD
+    // Byte scans, 16 bytes at a time. Each returns the first byte for which
+    // the mask is set, or the start of the last partial block.
+    inline unsigned first_set_bit(std::uint64_t m)
+    {
+#  if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_ctzll(m));
+#  else
+        auto i = 0u;
+        for (; !(m & 1); m >>= 1) { ++i; }
+        return i;
+#  endif
+    }
+
+#  if defined(__ARM_NEON)
+    using byte_block = uint8x16_t;
+
+    inline byte_block load_block(char const *p)
+    {
+        return vld1q_u8(reinterpret_cast<std::uint8_t const *>(p));
+    }
+
+    inline byte_block equal(byte_block v, char c)
+    {
+        return vceqq_u8(v, vdupq_n_u8(static_cast<std::uint8_t>(c)));
+    }
+
+    inline byte_block in_range(byte_block v, char lo, char hi)
+    {
+        return vcleq_u8(vsubq_u8(v, vdupq_n_u8(static_cast<std::uint8_t>(lo))),
+            vdupq_n_u8(static_cast<std::uint8_t>(hi - lo)));
+    }
+
+    // 4 bits per byte
+    inline std::uint64_t to_mask(byte_block m)
+    {
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+    }
+
+    constexpr unsigned bits_per_byte = 4;
+#  else
+    using byte_block = __m128i;
+
+    inline byte_block load_block(char const *p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+    }
+
+    inline byte_block equal(byte_block v, char c)
+    {
+        return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+    }
+
+    inline byte_block in_range(byte_block v, char lo, char hi)
+    {
+        auto const d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+        return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(static_cast<char>(hi - lo))), d);
+    }
+
+    inline std::uint64_t to_mask(byte_block m)
+    {
+        return static_cast<std::uint64_t>(_mm_movemask_epi8(m));
+    }
+
+    constexpr unsigned bits_per_byte = 1;
+#  endif
+
+    inline byte_block either(byte_block l, byte_block r)
+    {
+#  if defined(__ARM_NEON)
+        return vorrq_u8(l, r);
+#  else
+        return _mm_or_si128(l, r);
+#  endif
+    }
+
+    template <class Match>
+    char const *scan_blocks(char const *first, char const *last, Match match)
+    {
+        for (; last - first >= 16; first += 16) {
+            if (auto const m = to_mask(match(load_block(first)))) {
+                return first + first_set_bit(m) / bits_per_byte;
+            }
+        }
+        return first;
+    }
+#endif
+
+    template <class Iterator>
+    Iterator find_line_terminator(Iterator first, Iterator last)
+    {
+        using char_type = typename std::iterator_traits<Iterator>::value_type;
+        return std::find_if(first, last, &is_line_terminator<char_type>);
+    }
+
+    inline char const *find_line_terminator(char const *first, char const *last)
+    {
+#if GETOPTMM_HAS_SIMD
+        first = scan_blocks(first, last, [](byte_block v) {
+            return either(equal(v, '\n'), equal(v, '\r'));
+        });
+#endif
+        return std::find_if(first, last, &is_line_terminator<char>);
+    }
+
+    template <class Iterator, class Char>
+    Iterator find_char(Iterator first, Iterator last, Char c)
+    {
+        return std::find(first, last, c);
+    }
+
+    // memchr and the like are vectorized by the library
+    template <class Char>
+    Char const *find_char(Char const *first, Char const *last, Char c)
+    {
+        auto const p = std::char_traits<Char>::find(first, last - first, c);
+        return p ? p : last;
+    }
+
+    // Skips the blocks of plain bytes at the start of [first, last), if the
+    // blocks can be scanned at once.
+    inline char *skip_plain_blocks(char *first, char *last)
+    {
+#if GETOPTMM_HAS_SIMD
+        first = const_cast<char *>(scan_blocks(first, last, [](byte_block v) {
+            return either(
+                either(in_range(v, '\t', '\r'), equal(v, ' ')),
+                either(equal(v, '\\'), either(equal(v, '\''), equal(v, '"'))));
+        }));
+#else
+        static_cast<void>(last);
+#endif
+        return first;
+    }
+
+    // Classifies an argument in one pass, as "--([^=]*)(?:=(.*))?" and "-(.+)"
+    // would do (with '.' not matching a line terminator).
+    template <class Iterator>
+    token<Iterator> tokenize(Iterator first, Iterator last)
+    {
+        using char_type = typename std::iterator_traits<Iterator>::value_type;
+        auto const has_line_terminator = [](Iterator f, Iterator l)
+        {
+            return find_line_terminator(f, l) != l;
+        };
+
+        token<Iterator> ret = {token_type::non_option, last, last, false, last, last};
+        if (first == last || *first != char_type('-')) { return ret; }
+        auto const body = std::next(first);
+        if (body == last) {
+            // a lone "-" is non-option
+            return ret;
+        }
+        if (*body == char_type('-')) {
+            auto const name = std::next(body);
+            if (name == last) {
+                ret.type = token_type::end_of_options;
+                return ret;
+            }
+            auto const eq = find_char(name, last, char_type('='));
+            if (eq == last) {
+                ret.type = token_type::long_option;
+                ret.name_first = name;
+                ret.name_last = last;
+                return ret;
+            }
+            if (!has_line_terminator(std::next(eq), last)) {
+                ret.type = token_type::long_option;
+                ret.name_first = name;
+                ret.name_last = eq;
+                ret.has_value = true;
+                ret.value_first = std::next(eq);
+                return ret;
+            }
+            // the value contains a line terminator, and so does the body
+            return ret;
+        }
+        if (has_line_terminator(body, last)) { return ret; }
+        ret.type = token_type::short_option;
+        ret.name_first = body;
+        ret.name_last = last;
+        return ret;
+    }
+
+    constexpr std::size_t no_index = static_cast<std::size_t>(-1);
+    constexpr std::size_t ambiguous_index = no_index - 1;
+
+    inline void merge_index(std::size_t &to, std::size_t index)
+    {
+        if (to == no_index) { to = index; }
+        else if (to != index) { to = ambiguous_index; }
+    }
+
+    // Maps a short name to the index of the option which has it.
+    template <class Char, bool = (sizeof(Char) == 1)>
+    class short_name_index
+    {
+    public:
+        short_name_index() { m_table.fill(no_index); }
+
+        void insert(Char c, std::size_t index)
+        {
+            merge_index(m_table[static_cast<unsigned char>(c)], index);
+        }
+
+        void build() {}
+
+        std::size_t find(Char c) const
+        {
+            return m_table[static_cast<unsigned char>(c)];
+        }
+
+    private:
+        std::array<std::size_t, 256> m_table;
+    };
+
+    template <class Char>
+    class short_name_index<Char, false>
+    {
+    public:
+        void insert(Char c, std::size_t index)
+        {
+            m_table.emplace_back(c, index);
+        }
+
+        void build()
+        {
+            std::stable_sort(
+                m_table.begin(), m_table.end(),
+                [](auto const &l, auto const &r) { return l.first < r.first; });
+            auto out = m_table.begin();
+            for (auto it = m_table.begin(); it != m_table.end(); ++it) {
+                if (out != m_table.begin() && std::prev(out)->first == it->first) {
+                    merge_index(std::prev(out)->second, it->second);
+                } else {
+                    *out++ = *it;
+                }
+            }
+            m_table.erase(out, m_table.end());
+        }
+
+        std::size_t find(Char c) const
+        {
+            auto const it = std::lower_bound(
+                m_table.begin(), m_table.end(), c,
+                [](auto const &e, Char c) { return e.first < c; });
+            return it != m_table.end() && it->first == c ? it->second : no_index;
+        }
+
+    private:
+        std::vector<std::pair<Char, std::size_t>> m_table;
+    };
+
+    template <class Iterator>
+    constexpr std::size_t hash_range(Iterator first, Iterator last, std::size_t seed = 0)
+    {
+        // FNV-1a
+        std::size_t h = seed ^ (sizeof(std::size_t) == 8 ?
+            static_cast<std::size_t>(14695981039346656037ull) : 2166136261u);
+        std::size_t const prime = sizeof(std::size_t) == 8 ?
+            static_cast<std::size_t>(1099511628211ull) : 16777619u;
+        for (; first != last; ++first) {
+            h = (h ^ static_cast<std::size_t>(*first)) * prime;
+        }
+        return h;
+    }
+
+    // Orders characters as Traits::compare does; e.g. std::char_traits<char>
+    // compares them as unsigned char.
+    template <class Traits>
+    struct traits_less
+    {
+        template <class Char>
+        constexpr bool operator()(Char l, Char r) const
+        {
+            return Traits::lt(l, r);
+        }
+    };
+
+    struct long_name_match
+    {
+        match_type type;
+        std::size_t option;
+        // candidates of a partial match, as positions in sorted order
+        std::size_t first;
+        std::size_t last;
+    };
+
+    // Maps a long name or its abbreviation to the index of the option which
+    // has it. Exact matches are found by hashing, and abbreviations by binary
+    // search in the names sorted lexicographically.
+    template <class String>
+    class long_name_index
+    {
+    public:
+        using view_type = basic_string_view<typename String::value_type, typename String::traits_type>;
+
+        // name must outlive the index
+        void insert(view_type name, std::size_t index)
+        {
+            m_entries.push_back({name, hash_range(name.begin(), name.end()), index});
+        }
+
+        void build()
+        {
+            auto size = std::size_t(1);
+            while (size < m_entries.size() * 2) { size *= 2; }
+            m_slots.assign(size, no_index);
+            vector_t<String, entry> entries;
+            entries.reserve(m_entries.size());
+            for (auto &e : m_entries) {
+                auto const slot = find_slot(entries, e.name.begin(), e.name.end(), e.hash);
+                if (m_slots[slot] == no_index) {
+                    m_slots[slot] = entries.size();
+                    entries.push_back(std::move(e));
+                } else {
+                    merge_index(entries[m_slots[slot]].option, e.option);
+                }
+            }
+            m_entries = std::move(entries);
+
+            auto const n = m_entries.size();
+            m_sorted.resize(n);
+            for (std::size_t i = 0; i < n; ++i) { m_sorted[i] = i; }
+            std::sort(
+                m_sorted.begin(), m_sorted.end(),
+                [&](std::size_t l, std::size_t r) { return m_entries[l].name.compare(m_entries[r].name) < 0; });
+            m_run_last.resize(n);
+            for (auto k = n; k-- > 0; ) {
+                m_run_last[k] = k + 1 < n && option_at(k + 1) == option_at(k) ? m_run_last[k + 1] : k + 1;
+            }
+        }
+
+        template <class Iterator>
+        long_name_match find(Iterator first, Iterator last) const
+        {
+            auto const i = m_slots[find_slot(m_entries, first, last, hash_range(first, last))];
+            if (i != no_index) {
+                return {match_type::exact, m_entries[i].option, 0, 0};
+            }
+
+            auto const r = prefix_range(first, last);
+            if (r.first == r.second) {
+                return {match_type::none, no_index, 0, 0};
+            }
+            auto const l = r.first;
+            auto const h = r.second;
+            return {match_type::partial, m_run_last[l] < h ? ambiguous_index : option_at(l), l, h};
+        }
+
+        // the positions of the sorted names which start with [first, last)
+        template <class Iterator>
+        std::pair<std::size_t, std::size_t> prefix_range(Iterator first, Iterator last) const
+        {
+            auto const lo = std::lower_bound(
+                m_sorted.begin(), m_sorted.end(), 0,
+                [&](std::size_t e, int)
+                {
+                    auto const &name = m_entries[e].name;
+                    return std::lexicographical_compare(
+                        name.begin(), name.end(), first, last,
+                        traits_less<typename String::traits_type>());
+                });
+            auto const hi = std::partition_point(
+                lo, m_sorted.end(),
+                [&](std::size_t e)
+                {
+                    auto const &name = m_entries[e].name;
+                    return std::mismatch(first, last, name.begin(), name.end()).first == last;
+                });
+            return {std::size_t(lo - m_sorted.begin()), std::size_t(hi - m_sorted.begin())};
+        }
+
+        view_type name_at(std::size_t pos) const
+        {
+            return m_entries[m_sorted[pos]].name;
+        }
+
+        std::size_t size() const
+        {
+            return m_sorted.size();
+        }
+
+        std::size_t option_at(std::size_t pos) const
+        {
+            return m_entries[m_sorted[pos]].option;
+        }
+
+    private:
+        struct entry
+        {
+            view_type name;
+            std::size_t hash;
+            std::size_t option;
+        };
+
+        template <class Iterator>
+        std::size_t find_slot(
+            vector_t<String, entry> const &entries,
+            Iterator first, Iterator last, std::size_t hash) const
+        {
+            auto const mask = m_slots.size() - 1;
+            for (auto slot = hash & mask; ; slot = (slot + 1) & mask) {
+                auto const i = m_slots[slot];
+                if (i == no_index) { return slot; }
+                auto const &e = entries[i];
+                if (e.hash == hash &&
+                    std::equal(first, last, e.name.begin(), e.name.end())) {
+                    return slot;
+                }
+            }
+        }
+
+        vector_t<String, entry> m_entries;
+        vector_t<String, std::size_t> m_slots = vector_t<String, std::size_t>(1, no_index);
+        vector_t<String, std::size_t> m_sorted;
+        // m_run_last[k]: the end of the run of sorted names of the same option
+        vector_t<String, std::size_t> m_run_last;
+    };
+
+} // namespace detail
+
+enum class parse_flag
+{
+    none = 0,
+    posixly_correct = 1 << 0,
+    // expand @file arguments (parsers of char only)
+    response_files = 1 << 1
+};
+
+constexpr parse_flag operator|(parse_flag a, parse_flag b)
+{
+    return static_cast<parse_flag>(static_cast<int>(a) | static_cast<int>(b));
+}
+
+constexpr parse_flag operator&(parse_flag a, parse_flag b)
+{
+    return static_cast<parse_flag>(static_cast<int>(a) & static_cast<int>(b));
+}
+
+// What basic_parser::run reports to its statistics handler. Collected only
+// if GETOPTMM_INSTRUMENTATION is nonzero.
+struct parse_statistics
+{
+    std::size_t tokens = 0;
+    std::size_t short_lookups = 0;
+    std::size_t long_lookups = 0;
+    std::size_t exact_matches = 0;
+    std::size_t partial_matches = 0;
+    std::size_t conversions = 0;
+    std::size_t exceptions = 0;
+    // building the indices of the parser
+    std::chrono::nanoseconds construction{};
+    // the phases of run; handlers include conversions
+    std::chrono::nanoseconds tokenize{};
+    std::chrono::nanoseconds lookup{};
+    std::chrono::nanoseconds handlers{};
+    std::chrono::nanoseconds total{};
+};
+
+namespace detail {
+
+    template <class Table, class View>
+    auto select_command(Table &table, View arg, int) -> decltype(table.select_command(arg))
+    {
+        return table.select_command(arg);
+    }
+
+    template <class Table, class View>
+    bool select_command(Table &, View, long)
+    {
+        return false;
+    }
+
+#if GETOPTMM_INSTRUMENTATION
+
+    using statistics_clock = std::chrono::steady_clock;
+
+    // the statistics of the run in progress on this thread
+    inline parse_statistics *&current_statistics()
+    {
+        static thread_local parse_statistics *s = nullptr;
+        return s;
+    }
+
+    inline void count(std::size_t parse_statistics::*counter)
+    {
+        if (auto const s = current_statistics()) {
+            ++(s->*counter);
+        }
+    }
+
+    class phase_timer
+    {
+    public:
+        explicit phase_timer(std::chrono::nanoseconds parse_statistics::*phase)
+          : m_statistics(current_statistics()),
+            m_phase(phase),
+            m_start(m_statistics ? statistics_clock::now() : statistics_clock::time_point())
+        {}
+
+        phase_timer(phase_timer const &) = delete;
+        phase_timer &operator=(phase_timer const &) = delete;
+
+        ~phase_timer()
+        {
+            if (m_statistics) {
+                m_statistics->*m_phase += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    statistics_clock::now() - m_start);
+            }
+        }
+
+    private:
+        parse_statistics *m_statistics;
+        std::chrono::nanoseconds parse_statistics::*m_phase;
+        statistics_clock::time_point m_start;
+    };
+
+    // A table which counts and times the lookups and the handlers.
+    template <class Table>
+    struct instrumented_table
+    {
+        Table &table;
+
+        template <class Char>
+        std::size_t find_short(Char c) const
+        {
+            phase_timer t(&parse_statistics::lookup);
+            count(&parse_statistics::short_lookups);
+            return table.find_short(c);
+        }
+
+        template <class Char>
+        long_name_match find_long(Char const *first, Char const *last) const
+        {
+            phase_timer t(&parse_statistics::lookup);
+            count(&parse_statistics::long_lookups);
+            auto const m = table.find_long(first, last);
+            if (m.type == match_type::exact) { count(&parse_statistics::exact_matches); }
+            else if (m.type == match_type::partial) { count(&parse_statistics::partial_matches); }
+            return m;
+        }
+
+        decltype(auto) long_name_at(std::size_t pos) const
+        {
+            return table.long_name_at(pos);
+        }
+
+        arg_type get_arg_type(std::size_t i) const
+        {
+            return table.get_arg_type(i);
+        }
+
+        void execute(std::size_t i)
+        {
+            phase_timer t(&parse_statistics::handlers);
+            table.execute(i);
+        }
+
+        template <class View>
+        void execute(std::size_t i, View arg)
+        {
+            phase_timer t(&parse_statistics::handlers);
+            table.execute(i, arg);
+        }
+
+        template <class View>
+        void non_option(View arg)
+        {
+            phase_timer t(&parse_statistics::handlers);
+            table.non_option(arg);
+        }
+
+        template <class View>
+        void unrec_option(View arg)
+        {
+            phase_timer t(&parse_statistics::handlers);
+            table.unrec_option(arg);
+        }
+
+        template <class View>
+        bool select_command(View arg)
+        {
+            return detail::select_command(table, arg, 0);
+        }
+    };
+
+    // Calls f() collecting statistics for handler, if any.
+    template <class Handler, class F>
+    void run_instrumented(Handler const &handler, std::chrono::nanoseconds construction, F f)
+    {
+        if (!handler) {
+            f();
+            return;
+        }
+        parse_statistics s;
+        s.construction = construction;
+        auto &current = current_statistics();
+        auto const outer = current;
+        auto const start = statistics_clock::now();
+        auto const finish = [&] {
+            s.total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                statistics_clock::now() - start);
+            current = outer;
+            handler(s);
+        };
+        current = &s;
+#if GETOPTMM_HAS_EXCEPTIONS
+        try {
+            f();
+        } catch (...) {
+            ++s.exceptions;
+            finish();
+            throw;
+        }
+#else
+        f();
+#endif
+        finish();
+    }
+
+#else
+
+    inline void count(std::size_t parse_statistics::*) {}
+
+    struct phase_timer
+    {
+        explicit phase_timer(std::chrono::nanoseconds parse_statistics::*) {}
+    };
+
+#endif
+
+    template <class Iterator>
+    token<Iterator> classify(Iterator first, Iterator last)
+    {
+        phase_timer t(&parse_statistics::tokenize);
+        count(&parse_statistics::tokens);
+        return tokenize(first, last);
+    }
+
+    template <class String>
+    struct throw_unrec_option
+    {
+        using view_handler_tag = void;
+
+        template <class View>
+        void operator()(View a) const
+        {
+            auto message = GETOPTMM_STRING(String, "unrecognized option: ");
+            message.append(a.data(), a.size());
+            report_error<String>(error_type::unrecognized_option, std::move(message));
+        }
+
+        template <class Context, class View>
+        void operator()(Context &, View a) const
+        {
+            (*this)(a);
+        }
+    };
+
+    constexpr bool has_flag(parse_flag flags, parse_flag f)
+    {
+        return (flags & f) == f;
+    }
+
+    // The contents of a response file. The file is mapped privately where
+    // possible so that quotes and backslashes can be removed in place.
+    class response_file
+    {
+    public:
+#if GETOPTMM_HAS_MMAP
+        struct id_type
+        {
+            dev_t dev;
+            ino_t ino;
+
+            bool operator==(id_type const &other) const
+            {
+                return dev == other.dev && ino == other.ino;
+            }
+        };
+#else
+        using id_type = std::string;
+#endif
+
+        response_file() = default;
+        response_file(response_file const &) = delete;
+        response_file &operator=(response_file const &) = delete;
+
+        ~response_file()
+        {
+#if GETOPTMM_HAS_MMAP
+            if (m_mapped) {
+                ::munmap(m_data, m_size);
+            }
+#endif
+        }
+
+        // false if the file cannot be read
+        bool open(char const *path)
+        {
+#if GETOPTMM_HAS_MMAP
+            auto const fd = ::open(path, O_RDONLY);
+            if (fd == -1) {
+                return false;
+            }
+            struct stat st;
+            auto ok = ::fstat(fd, &st) == 0 && !S_ISDIR(st.st_mode);
+            if (ok) {
+                m_id = {st.st_dev, st.st_ino};
+                if (S_ISREG(st.st_mode) && st.st_size > 0) {
+                    auto const p = ::mmap(
+                        nullptr, static_cast<std::size_t>(st.st_size),
+                        PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                    if (p != MAP_FAILED) {
+                        m_data = static_cast<char *>(p);
+                        m_size = static_cast<std::size_t>(st.st_size);
+                        m_mapped = true;
+                    }
+                }
+                // not mappable (e.g. a pipe), or empty
+                char buf[4096];
+                for (ssize_t n; !m_mapped && (n = ::read(fd, buf, sizeof(buf))) != 0; ) {
+                    if (n == -1) {
+                        ok = false;
+                        break;
+                    }
+                    m_buffer.insert(m_buffer.end(), buf, buf + n);
+                }
+            }
+            ::close(fd);
+            if (!ok) {
+                return false;
+            }
+#else
+            std::ifstream ifs(path, std::ios_base::binary);
+            if (!ifs) {
+                return false;
+            }
+            m_buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+            if (ifs.bad()) {
+                return false;
+            }
+            m_id = path;
+#endif
+            if (!m_mapped) {
+                m_data = m_buffer.data();
+                m_size = m_buffer.size();
+            }
+            return true;
+        }
+
+        id_type const &id() const
+        {
+            return m_id;
+        }
+
+        char *data() const
+        {
+            return m_data;
+        }
+
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+        // Splits the contents in place as libiberty's buildargv does:
+        // arguments are separated by whitespace, and quotes and backslashes
+        // are removed. f(argument) is called for each.
+        template <class F>
+        void split(F f)
+        {
+            for (auto it = m_data, last = m_data + m_size; ; ) {
+                while (it != last && is_space(*it)) {
+                    ++it;
+                }
+                if (it == last) {
+                    return;
+                }
+                auto const first = it;
+                auto out = it;
+                char quote = 0;
+                for (; it != last; ++it) {
+                    // copy a run of plain characters at once
+                    auto const run = skip_plain_blocks(it, last);
+                    if (run != it) {
+                        if (out != it) {
+                            std::memmove(out, it, run - it);
+                        }
+                        out += run - it;
+                        it = run;
+                        if (it == last) {
+                            break;
+                        }
+                    }
+                    auto c = *it;
+                    if (c == '\\') {
+                        if (++it == last) {
+                            break;
+                        }
+                        c = *it;
+                    } else if (quote) {
+                        if (c == quote) {
+                            quote = 0;
+                            continue;
+                        }
+                    } else if (c == '\'' || c == '"') {
+                        quote = c;
+                        continue;
+                    } else if (is_space(c)) {
+                        break;
+                    }
+                    if (out != it) {
+                        *out = c;
+                    }
+                    ++out;
+                }
+                f(basic_string_view<char>(first, out - first));
+            }
+        }
+
+    private:
+        char *m_data = nullptr;
+        std::size_t m_size = 0;
+        bool m_mapped = false;
+        std::vector<char> m_buffer;
+        id_type m_id = {};
+    };
+
+    using response_file_list = std::vector<std::unique_ptr<response_file>>;
+
+    // where the response files read on this thread are kept, if anywhere
+    inline response_file_list *&current_response_files()
+    {
+        static thread_local response_file_list *s = nullptr;
+        return s;
+    }
+
+    // Keeps the response files read in the scope in files, so that a run
+    // can release them at its end, after its asynchronous handlers.
+    struct response_file_scope
+    {
+        response_file_list *saved = current_response_files();
+
+        explicit response_file_scope(response_file_list &files) { current_response_files() = &files; }
+        ~response_file_scope() { current_response_files() = saved; }
+        response_file_scope(response_file_scope const &) = delete;
+        response_file_scope &operator=(response_file_scope const &) = delete;
+    };
+
+    // Opens the file at path, kept until the end of the run if the run keeps
+    // them or else in local. Returns null if it cannot be read.
+    inline response_file *open_response_file(char const *path, response_file &local)
+    {
+        auto const kept = current_response_files();
+        if (!kept) { return local.open(path) ? &local : nullptr; }
+        kept->emplace_back(new response_file);
+        if (kept->back()->open(path)) { return kept->back().get(); }
+        kept->pop_back();
+        return nullptr;
+    }
+
+    // What parse_argument carries from one argument to the next.
+    template <class String>
+    struct parse_state
+    {
+        // the option waiting for its argument, and its name for the error
+        std::size_t pending = no_index;
+        typename String::value_type pending_short = {};
+        String pending_long;
+        // after "--", or after a non-option with parse_flag::posixly_correct
+        bool rest_non_option = false;
+        // the response files being read, to detect recursion
+        vector_t<String, response_file::id_type> response_files;
+        // after a subcommand, which takes the rest of the arguments
+        bool stop = false;
+    };
+
+    // One step of the parsing loop shared by the parsers. A table provides:
+    //   find_short(c), find_long(first, last), long_name_at(pos),
+    //   get_arg_type(i), execute(i), execute(i, arg),
+    //   non_option(arg) and unrec_option(arg)
+    // and may provide select_command(arg), which returns true if the
+    // non-option arg is a subcommand.
+    template <class String, class Table>
+    void parse_argument(
+        Table &table, parse_state<String> &state,
+        basic_string_view<typename String::value_type, typename String::traits_type> arg,
+        parse_flag flag)
+    {
+        using string_type = String;
+        using view_type = decltype(arg);
+
+        using char_type = typename String::value_type;
+        auto const str = [](view_type v) { return to_string<string_type>(v); };
+        if (state.pending != no_index) {
+            auto const i = state.pending;
+            state.pending = no_index;
+            table.execute(i, arg);
+            return;
+        }
+        if (state.rest_non_option) {
+            table.non_option(arg);
+            return;
+        }
+        auto const tok = classify(arg.data(), arg.data() + arg.size());
+        if (tok.type == token_type::end_of_options) {
+            // the rest are non-option
+            state.rest_non_option = true;
+        } else if (tok.type == token_type::long_option) {
+            // long option
+            view_type const name(tok.name_first, tok.name_last - tok.name_first);
+            auto const m = table.find_long(tok.name_first, tok.name_last);
+            if (m.type == match_type::none) {
+                table.unrec_option(arg);
+                return;
+            }
+            if (m.option == ambiguous_index) {
+                auto message = GETOPTMM_STRING(string_type, "ambiguous option: --") + str(name);
+                if (m.type == match_type::partial) {
+                    for (auto pos = m.first; pos != m.last; ++pos) {
+                        message += pos == m.first ?
+                            GETOPTMM_LITERAL(char_type, " (--") : GETOPTMM_LITERAL(char_type, ", --");
+                        message += str(table.long_name_at(pos));
+                    }
+                    message += GETOPTMM_LITERAL(char_type, ")");
+                }
+                report_error(error_type::ambiguous_option, std::move(message));
+                return;
+            }
+            auto const i = m.option;
+            auto const n = table.get_arg_type(i);
+            view_type const value(tok.value_first, tok.value_last - tok.value_first);
+            if (n == arg_type::none) {
+                if (tok.has_value) {
+                    report_error(
+                        error_type::argument_not_allowed,
+                        GETOPTMM_STRING(string_type, "argument not allowed: --") + str(name));
+                    return;
+                }
+                table.execute(i);
+            } else if (n == arg_type::optional) {
+                if (tok.has_value) {
+                    table.execute(i, value);
+                } else {
+                    table.execute(i);
+                }
+            } else {
+                if (tok.has_value) {
+                    table.execute(i, value);
+                } else {
+                    state.pending = i;
+                    state.pending_short = {};
+                    state.pending_long.assign(tok.name_first, tok.name_last);
+                }
+            }
+        } else if (tok.type == token_type::short_option) {
+            // short option
+            for (auto cit = tok.name_first, clast = tok.name_last; cit != clast; ++cit) {
+                auto name = *cit;
+                auto const i = table.find_short(name);
+                if (i == no_index) {
+                    table.unrec_option(GETOPTMM_STRING(string_type, "-") + string_type(cit, clast));
+                    continue;
+                }
+                if (i == ambiguous_index) {
+                    report_error(
+                        error_type::ambiguous_option, GETOPTMM_STRING(string_type, "ambiguous option: -") + name);
+                    return;
+                }
+                auto const n = table.get_arg_type(i);
+                if (n == arg_type::none) {
+                    table.execute(i);
+                } else if (n == arg_type::optional) {
+                    if (++cit == clast) { table.execute(i); }
+                    else { table.execute(i, view_type(cit, clast - cit)); }
+                    break;
+                } else {
+                    if (++cit == clast) {
+                        state.pending = i;
+                        state.pending_short = name;
+                    } else {
+                        table.execute(i, view_type(cit, clast - cit));
+                    }
+                    break;
+                }
+            };
+        } else if (state.response_files.empty() && select_command(table, arg, 0)) {
+            // subcommand (the rest are its arguments)
+            state.stop = true;
+        } else if (has_flag(flag, parse_flag::posixly_correct)) {
+            // non-option (the rest are treated as so)
+            state.rest_non_option = true;
+            table.non_option(arg);
+        } else {
+            // non-option
+            table.non_option(arg);
+        }
+    }
+
+    // Ends the arguments, and makes the state ready for the next ones.
+    template <class String>
+    void finish_arguments(parse_state<String> &state)
+    {
+        auto const pending = state.pending != no_index;
+        auto const pending_short = state.pending_short;
+        state.pending = no_index;
+        state.rest_non_option = false;
+        state.response_files.clear();
+        if (pending) {
+            report_error(
+                error_type::argument_required,
+                pending_short != decltype(pending_short)() ?
+                    GETOPTMM_STRING(String, "argument required: -") + pending_short :
+                    GETOPTMM_STRING(String, "argument required: --") + state.pending_long);
+        }
+    }
+
+    template <class String, class Table, class View>
+    void expand_argument(Table &table, parse_state<String> &state, View arg, parse_flag flag)
+    {
+        parse_argument(table, state, arg, flag);
+    }
+
+    // Replaces @file with the arguments read from file, as GCC does. If file
+    // cannot be read, @file is kept as is.
+    template <class String, class Table, class Traits>
+    void expand_argument(
+        Table &table, parse_state<String> &state,
+        basic_string_view<char, Traits> arg, parse_flag flag)
+    {
+        if (!has_flag(flag, parse_flag::response_files) || arg.empty() || arg[0] != '@') {
+            parse_argument(table, state, arg, flag);
+            return;
+        }
+        // released at return unless kept
+        response_file local;
+        auto const opened = open_response_file(std::string(arg.data() + 1, arg.size() - 1).c_str(), local);
+        if (!opened) {
+            parse_argument(table, state, arg, flag);
+            return;
+        }
+        auto &file = *opened;
+        auto &ids = state.response_files;
+        if (std::find(ids.begin(), ids.end(), file.id()) != ids.end()) {
+            report_error(
+                error_type::recursive_response_file,
+                GETOPTMM_STRING(String, "recursive response file: ") + to_string<String>(arg));
+            return;
+        }
+        ids.push_back(file.id());
+        struct pop_guard
+        {
+            decltype(state.response_files) &ids;
+            ~pop_guard() { ids.pop_back(); }
+        } guard = {ids};
+        auto const sink = current_error_sink<String>();
+        transient_scope transient;
+        file.split([&](basic_string_view<char> a) {
+            basic_string_view<char, Traits> const v(a.data(), a.size());
+            if (sink) { sink->token = v; }
+            expand_argument(table, state, v, flag);
+        });
+        if (sink) { sink->token = arg; }
+    }
+
+    // Calls f(), where an error thrown by a handler is collected as reported,
+    // and ends only the argument.
+    template <class String, class F>
+    void collect_thrown(F f)
+    {
+#if GETOPTMM_HAS_EXCEPTIONS
+        try {
+            f();
+        } catch (basic_parse_error<String> const &e) {
+            report_error(e.type(), e.message());
+        }
+#else
+        f();
+#endif
+    }
+
+    // An asynchronous handler being run, with the argument for its errors.
+    template <class String>
+    struct async_call
+    {
+        std::future<void> result;
+        std::size_t index;
+        String token;
+    };
+
+    // Waits for all the handlers, even if one of them throws. Their errors
+    // are reported (or the first is thrown) as if thrown when they were
+    // called.
+    template <class String, class Calls>
+    void join_async(Calls &calls)
+    {
+        auto const sink = current_error_sink<String>();
+#if GETOPTMM_HAS_EXCEPTIONS
+        std::exception_ptr error;
+        for (auto &a : calls) {
+            if (sink) {
+                sink->index = a.index;
+                sink->token = a.token;
+            }
+            try {
+                collect_thrown<String>([&] { a.result.get(); });
+            } catch (...) {
+                if (!error) { error = std::current_exception(); }
+            }
+        }
+        calls.clear();
+        if (error) { std::rethrow_exception(error); }
+#else
+        static_cast<void>(sink);
+        for (auto &a : calls) { a.result.get(); }
+        calls.clear();
+#endif
+    }
+
+    // The state of an option of occurrence_type other than accumulate.
+    template <class String>
+    struct occurrence
+    {
+        bool given = false;
+        // the last argument, for occurrence_type::last
+        bool has_arg = false;
+        String arg;
+        std::size_t index = 0;
+    };
+
+    // Returns the end of the arguments parsed, which is after the subcommand
+    // if one is selected.
+    template <class String, class Table, class Iterator>
+    Iterator parse_arguments(Table &table, Iterator first, Iterator last, parse_flag flag)
+    {
+        using view_type = basic_string_view<
+            typename String::value_type,
+            typename String::traits_type>;
+
+        parse_state<String> state;
+        invalid_value_scope<String> scope;
+        auto const sink = current_error_sink<String>();
+        if (!sink) {
+            for (; first != last && !state.stop; ++first) {
+                auto &&arg = *first;
+                expand_argument(table, state, view_type(arg), flag);
+            }
+            finish_arguments(state);
+            return first;
+        }
+        for (; first != last && !state.stop; ++first, ++sink->index) {
+            auto &&arg = *first;
+            sink->token = view_type(arg);
+            collect_thrown<String>([&] { expand_argument(table, state, sink->token, flag); });
+        }
+        if (state.pending != no_index) {
+            // the option waiting for its argument is the last one
+            --sink->index;
+        }
+        finish_arguments(state);
+        return first;
+    }
+
+} // namespace detail
+
+namespace detail {
+
+    // The layout of a schema, in 32-bit words:
+    //   header (schema_header_size words)
+    //   option_count argument types
+    //   short_count pairs of (character, option)
+    //   long_count quadruples of (offset, size, option, end of run), by name
+    //   slot_count indices of the long names, by hash (schema_none if empty)
+    //   char_count characters of the names and the help message, padded
+    // Options are no_index or ambiguous_index as schema_none and
+    // schema_ambiguous.
+    constexpr std::uint32_t schema_magic = 0x534d4f47; // "GOMS"
+    constexpr std::uint32_t schema_version = 1;
+    constexpr std::uint32_t schema_none = 0xffffffffu;
+    constexpr std::uint32_t schema_ambiguous = 0xfffffffeu;
+
+    enum schema_field
+    {
+        schema_magic_field,
+        schema_version_field,
+        schema_char_size_field,
+        schema_option_count_field,
+        schema_short_count_field,
+        schema_long_count_field,
+        schema_slot_count_field,
+        schema_char_count_field,
+        schema_usage_offset_field,
+        schema_usage_size_field,
+        schema_header_size
+    };
+
+    template <class Iterator>
+    constexpr std::uint32_t schema_hash(Iterator first, Iterator last)
+    {
+        // FNV-1a, 32 bits
+        std::uint32_t h = 2166136261u;
+        for (; first != last; ++first) {
+            h = (h ^ static_cast<std::uint32_t>(*first)) * 16777619u;
+        }
+        return h;
+    }
+
+    // a short name as stored, which orders the names as unsigned
+    template <class Char>
+    constexpr std::uint32_t to_schema_char(Char c)
+    {
+        return static_cast<std::uint32_t>(static_cast<std::make_unsigned_t<Char>>(c));
+    }
+
+    inline std::uint32_t to_schema_index(std::size_t i)
+    {
+        return i == no_index ? schema_none :
+            i == ambiguous_index ? schema_ambiguous : static_cast<std::uint32_t>(i);
+    }
+
+    inline std::size_t from_schema_index(std::uint32_t i)
+    {
+        return i == schema_none ? no_index : i == schema_ambiguous ? ambiguous_index : i;
+    }
+
+    template <class Char>
+    class schema_writer
+    {
+    public:
+        void begin(std::size_t options)
+        {
+            m_options.reserve(options);
+        }
+
+        void add_option(arg_type type)
+        {
+            m_options.push_back(static_cast<std::uint32_t>(type));
+        }
+
+        // in order of the characters
+        void add_short(Char c, std::size_t option)
+        {
+            m_shorts.push_back(to_schema_char(c));
+            m_shorts.push_back(to_schema_index(option));
+        }
+
+        void merge_short(std::size_t option)
+        {
+            auto i = from_schema_index(m_shorts.back());
+            merge_index(i, option);
+            m_shorts.back() = to_schema_index(i);
+        }
+
+        // in order of the names
+        void add_long(Char const *name, std::size_t size, std::size_t option)
+        {
+            m_longs.push_back(static_cast<std::uint32_t>(m_chars.size()));
+            m_longs.push_back(static_cast<std::uint32_t>(size));
+            m_longs.push_back(to_schema_index(option));
+            m_longs.push_back(0);
+            m_chars.insert(m_chars.end(), name, name + size);
+        }
+
+        template <class OutputIterator>
+        OutputIterator finish(Char const *usage, std::size_t usage_size, OutputIterator out)
+        {
+            std::size_t const n = m_longs.size() / 4;
+            // the end of the run of names of the same option
+            for (auto k = n; k-- > 0; ) {
+                auto const same = k + 1 < n && m_longs[(k + 1) * 4 + 2] == m_longs[k * 4 + 2];
+                m_longs[k * 4 + 3] = same ? m_longs[(k + 1) * 4 + 3] : static_cast<std::uint32_t>(k + 1);
+            }
+            std::size_t slots = 1;
+            while (slots < n * 2) { slots *= 2; }
+            std::vector<std::uint32_t> table(slots, schema_none);
+            for (std::size_t k = 0; k < n; ++k) {
+                auto const name = m_chars.data() + m_longs[k * 4];
+                auto slot = schema_hash(name, name + m_longs[k * 4 + 1]) & (slots - 1);
+                while (table[slot] != schema_none) { slot = (slot + 1) & (slots - 1); }
+                table[slot] = static_cast<std::uint32_t>(k);
+            }
+            auto const usage_offset = m_chars.size();
+            m_chars.insert(m_chars.end(), usage, usage + usage_size);
+
+            std::uint32_t const header[schema_header_size] = {
+                schema_magic, schema_version, sizeof(Char),
+                static_cast<std::uint32_t>(m_options.size()),
+                static_cast<std::uint32_t>(m_shorts.size() / 2),
+                static_cast<std::uint32_t>(n),
+                static_cast<std::uint32_t>(slots),
+                static_cast<std::uint32_t>(m_chars.size()),
+                static_cast<std::uint32_t>(usage_offset),
+                static_cast<std::uint32_t>(usage_size)};
+            out = write(header, schema_header_size, std::move(out));
+            out = write(m_options.data(), m_options.size(), std::move(out));
+            out = write(m_shorts.data(), m_shorts.size(), std::move(out));
+            out = write(m_longs.data(), m_longs.size(), std::move(out));
+            out = write(table.data(), table.size(), std::move(out));
+            out = write(m_chars.data(), m_chars.size(), std::move(out));
+            for (auto pad = m_chars.size() * sizeof(Char); pad % 4 != 0; ++pad) {
+                *out++ = 0;
+            }
+            return out;
+        }
+
+    private:
+        template <class T, class OutputIterator>
+        static OutputIterator write(T const *data, std::size_t size, OutputIterator out)
+        {
+            auto const bytes = reinterpret_cast<unsigned char const *>(data);
+            return std::copy(bytes, bytes + size * sizeof(T), std::move(out));
+        }
+
+        std::vector<std::uint32_t> m_options;
+        std::vector<std::uint32_t> m_shorts;
+        std::vector<std::uint32_t> m_longs;
+        std::vector<Char> m_chars;
+    };
+
+} // namespace detail
+
+// Sources of options other than argv, for run and try_run. A source has
+//   template <class F> void for_each(F f) const
+// which calls f(name, value) for each option, with name the long name and
+// value a pointer to the argument, or null if there is none. Unknown names
+// are ignored, unless the source has a member type strict_tag.
+
+namespace detail {
+
+    inline char **environment()
+    {
+#if defined(_WIN32)
+        return _environ;
+#elif defined(__APPLE__)
+        return *_NSGetEnviron();
+#else
+        return environ;
+#endif
+    }
+
+    template <class Char>
+    basic_string_view<Char> trim(Char *first, Char *last)
+    {
+        while (first != last && is_space(*first)) { ++first; }
+        while (first != last && is_space(*std::prev(last))) { --last; }
+        return basic_string_view<Char>(first, last - first);
+    }
+
+    template <class Source, class = void>
+    struct is_strict_source : std::false_type {};
+
+    template <class Source>
+    struct is_strict_source<Source, void_t<typename Source::strict_tag>> : std::true_type {};
+
+} // namespace detail
+
+// Options from the environment variables which start with prefix: e.g. for
+// "MYTOOL_", MYTOOL_OUTPUT_DIR=x is read as --output-dir=x.
+class environment_source
+{
+public:
+    explicit environment_source(std::string prefix)
+      : m_prefix(std::move(prefix))
+    {}
+
+    template <class F>
+    void for_each(F f) const
+    {
+        std::string name;
+        for (auto env = detail::environment(); env && *env; ++env) {
+            auto const e = *env;
+            if (std::strncmp(e, m_prefix.c_str(), m_prefix.size()) != 0) { continue; }
+            auto const eq = std::strchr(e + m_prefix.size(), '=');
+            if (!eq) { continue; }
+            name.assign(e + m_prefix.size(), eq);
+            for (auto &c : name) {
+                if (c == '_') { c = '-'; }
+                else if ('A' <= c && c <= 'Z') { c = static_cast<char>(c - 'A' + 'a'); }
+            }
+            basic_string_view<char> const value(eq + 1);
+            f(basic_string_view<char>(name), &value);
+        }
+    }
+
+private:
+    std::string m_prefix;
+};
+
+// Options from the lines of a file, each "name = value" or "name". Empty
+// lines, comments (starting with '#' or ';') and [section] lines are
+// skipped, and a value may be quoted. The file is read (mapped if possible)
+// on each run, kept until its end as a response file, and is ignored if it
+// cannot be read. Unknown names are errors.
+class config_file_source
+{
+public:
+    using strict_tag = void;
+
+    explicit config_file_source(std::string path)
+      : m_path(std::move(path))
+    {}
+
+    template <class F>
+    void for_each(F f) const
+    {
+        detail::response_file local;
+        auto const file = detail::open_response_file(m_path.c_str(), local);
+        if (!file) { return; }
+        // the values are gone after the run, so lazy values copy them
+        detail::transient_scope transient;
+        for (auto it = file->data(), last = it + file->size(); it != last; ) {
+            auto const eol = std::find(it, last, '\n');
+            auto const line = detail::trim(it, eol);
+            it = eol == last ? last : std::next(eol);
+            if (line.empty() || line[0] == '#' || line[0] == ';' || line[0] == '[') { continue; }
+            auto const first = const_cast<char *>(line.data());
+            auto const line_last = first + line.size();
+            auto const eq = std::find(first, line_last, '=');
+            auto const name = detail::trim(first, eq);
+            if (eq == line_last) {
+                f(name, nullptr);
+                continue;
+            }
+            auto value = detail::trim(std::next(eq), line_last);
+            if (value.size() >= 2 && (value[0] == '"' || value[0] == '\'') &&
+                value[value.size() - 1] == value[0]) {
+                value = basic_string_view<char>(value.data() + 1, value.size() - 2);
+            }
+            f(name, &value);
+        }
+    }
+
+private:
+    std::string m_path;
+};
+
+// The result of parse_batch, column by column. Rows are the positions of the
+// argument vectors in the batch, and values refer to the arguments in place.
+template <class String>
+struct basic_batch_result
+{
+    using view_type = basic_string_view<
+        typename String::value_type,
+        typename String::traits_type>;
+
+    // the occurrences of an option or of non-options, in order; the value is
+    // a default-constructed view if the option has no argument
+    struct column
+    {
+        detail::vector_t<String, std::size_t> rows;
+        detail::vector_t<String, view_type> values;
+    };
+
+    // one column per option, in the order given to the parser
+    detail::vector_t<String, column> options;
+    column non_options;
+    // the errors, each with its row; index is the position in the row
+    detail::vector_t<String, std::size_t> error_rows;
+    detail::vector_t<String, basic_error_info<String>> errors;
+};
+
+using batch_result = basic_batch_result<std::string>;
+using wbatch_result = basic_batch_result<std::wstring>;
+
+// The result of basic_parser::record: the options and the non-options of an
+// argument vector as parallel arrays, in order. Values refer to the
+// arguments in place, and positions are the indices of the arguments.
+template <class String>
+struct basic_parse_record
+{
+    using view_type = basic_string_view<
+        typename String::value_type,
+        typename String::traits_type>;
+
+    // the index of each option given (in the order given to the parser), its
+    // argument (a default-constructed view if none) and its position
+    detail::vector_t<String, std::size_t> options;
+    detail::vector_t<String, view_type> values;
+    detail::vector_t<String, std::size_t> positions;
+    detail::vector_t<String, view_type> non_options;
+    detail::vector_t<String, std::size_t> non_option_positions;
+
+    void reserve(std::size_t n)
+    {
+        options.reserve(n);
+        values.reserve(n);
+        positions.reserve(n);
+        non_options.reserve(n);
+        non_option_positions.reserve(n);
+    }
+
+    void clear() noexcept
+    {
+        options.clear();
+        values.clear();
+        positions.clear();
+        non_options.clear();
+        non_option_positions.clear();
+    }
+};
+
+using parse_record = basic_parse_record<std::string>;
+using wparse_record = basic_parse_record<std::wstring>;
+
+namespace detail {
+
+    template <class T, class Allocator>
+    void append(std::vector<T, Allocator> &to, std::vector<T, Allocator> &from)
+    {
+        to.insert(to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+    }
+
+    template <class String>
+    void append(
+        typename basic_batch_result<String>::column &to,
+        typename basic_batch_result<String>::column &from)
+    {
+        append(to.rows, from.rows);
+        append(to.values, from.values);
+    }
+
+    // Appends the rows of from, which follow those of to.
+    template <class String>
+    void append(basic_batch_result<String> &to, basic_batch_result<String> &from)
+    {
+        for (std::size_t i = 0; i < to.options.size(); ++i) {
+            append<String>(to.options[i], from.options[i]);
+        }
+        append<String>(to.non_options, from.non_options);
+        append(to.error_rows, from.error_rows);
+        append(to.errors, from.errors);
+    }
+
+} // namespace detail
+
+// With a Context, the parser holds no destination of its own: run takes a
+// context, which is given to the handlers, so that one parser can be reused
+// for many results.
+template <class String, class Context = void>
+class basic_parser
+{
+public:
+    using char_type = typename String::value_type;
+    using string_type = String;
+    using view_type = basic_string_view<char_type, typename string_type::traits_type>;
+    using context_type = detail::context_t<Context>;
+    using option_type = basic_option<String, Context>;
+    using error = basic_parse_error<String>;
+    using error_info = basic_error_info<String>;
+    using error_list = detail::vector_t<string_type, error_info>;
+
+    template <class Iterator, class NonOptionHandler>
+    basic_parser(
+        Iterator first, Iterator last,
+        NonOptionHandler &&non_option_handler,
+        parse_flag flag = parse_flag::none)
+      : basic_parser(
+          std::move(first), std::move(last),
+          std::forward<NonOptionHandler>(non_option_handler),
+          detail::throw_unrec_option<string_type>(),
+          flag)
+    {}
+
+    template <
+        class Iterator, class NonOptionHandler, class UnrecOptionHandler,
+        std::enable_if_t<!std::is_same<std::decay_t<UnrecOptionHandler>, parse_flag>::value> * = nullptr>
+    basic_parser(
+        Iterator first, Iterator last,
+        NonOptionHandler &&non_option_handler,
+        UnrecOptionHandler &&unrec_option_handler,
+        parse_flag flag = parse_flag::none)
+      : m_options(std::move(first), std::move(last)),
+        m_non_option_handler(
+            detail::adapt_arg_handler<string_type>(
+                std::forward<NonOptionHandler>(non_option_handler))),
+        m_unrec_option_handler(
+            detail::adapt_arg_handler<string_type>(
+                std::forward<UnrecOptionHandler>(unrec_option_handler))),
+        m_flag(flag)
+    {
+        build();
+    }
+
+    // The lookup tables refer to the names in m_options, so a copy builds
+    // its own.
+    basic_parser(basic_parser const &other)
+      : m_options(other.m_options),
+        m_non_option_handler(other.m_non_option_handler),
+        m_unrec_option_handler(other.m_unrec_option_handler),
+        m_flag(other.m_flag),
+        m_usage_width(other.m_usage_width),
+        m_commands(other.m_commands)
+#if GETOPTMM_INSTRUMENTATION
+        , m_statistics_handler(other.m_statistics_handler)
+#endif
+    {
+        build();
+    }
+
+    // m_options is moved with its storage, and so are the names
+    basic_parser(basic_parser &&) = default;
+
+    basic_parser &operator=(basic_parser const &other)
+    {
+        if (this != &other) {
+            basic_parser tmp(other);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+
+    basic_parser &operator=(basic_parser &&other)
+    {
+        if (this != &other) {
+            m_options = std::move(other.m_options);
+            m_non_option_handler = std::move(other.m_non_option_handler);
+            m_unrec_option_handler = std::move(other.m_unrec_option_handler);
+            m_flag = other.m_flag;
+            m_usage_width = other.m_usage_width;
+            m_commands = std::move(other.m_commands);
+#if GETOPTMM_INSTRUMENTATION
+            m_statistics_handler = std::move(other.m_statistics_handler);
+#endif
+            // the storage may not be moved with the allocator
+            build();
+        }
+        return *this;
+    }
+
+    // Adds an option, or the options in [first, last), after those given
+    // so far, and rebuilds the lookup tables; add many at once if possible.
+    // With std::make_move_iterator (here or in the constructor), the options
+    // are moved, and their names and handlers are not copied.
+    basic_parser &add_option(option_type option)
+    {
+        m_options.push_back(std::move(option));
+        build();
+        return *this;
+    }
+
+    template <class Iterator>
+    basic_parser &add_options(Iterator first, Iterator last)
+    {
+        m_options.insert(m_options.end(), std::move(first), std::move(last));
+        build();
+        return *this;
+    }
+
+    // Wraps the descriptions in the help message to fit in width columns,
+    // e.g. those of the terminal; 0 (the default) does not wrap them.
+    basic_parser &set_usage_width(std::size_t width)
+    {
+        m_usage_width = width;
+        m_usage.reset();
+        return *this;
+    }
+
+    // run and try_run do not modify the parser, and may be called
+    // concurrently; the state of a parse is local to the call.
+    //
+    // The sources (see environment_source) are read after the arguments, in
+    // order of decreasing precedence: an option found in the arguments or in
+    // a source is not taken from the later ones, and their handlers are not
+    // called for it.
+    template <class... Sources>
+    void run(int argc, char_type **argv, Sources const &...sources) const
+    {
+        run(argv + 1, argv + argc, sources...);
+    }
+
+    template <class Iterator, class... Sources>
+    void run(Iterator first, Iterator last, Sources const &...sources) const
+    {
+        static_assert(std::is_void<Context>::value, "a context is required");
+        detail::error_sink_scope<string_type> throwing(nullptr);
+        run_in(nullptr, first, last, sources...);
+    }
+
+    template <class... Sources>
+    void run(context_type &c, int argc, char_type **argv, Sources const &...sources) const
+    {
+        run(c, argv + 1, argv + argc, sources...);
+    }
+
+    template <class Iterator, class... Sources>
+    void run(context_type &c, Iterator first, Iterator last, Sources const &...sources) const
+    {
+        detail::error_sink_scope<string_type> throwing(nullptr);
+        run_in(&c, first, last, sources...);
+    }
+
+    // Parses without throwing basic_parse_error: the errors are collected,
+    // and each ends only the argument in which it is found. The index of an
+    // error in a source is detail::no_index. A run (or another call which
+    // throws) in a handler still throws.
+    template <class... Sources>
+    error_list try_run(int argc, char_type **argv, Sources const &...sources) const
+    {
+        static_assert(std::is_void<Context>::value, "a context is required");
+        return detail::collect_errors<string_type>(1, [&] { run_in(nullptr, argv + 1, argv + argc, sources...); });
+    }
+
+    template <class Iterator, class... Sources>
+    error_list try_run(Iterator first, Iterator last, Sources const &...sources) const
+    {
+        static_assert(std::is_void<Context>::value, "a context is required");
+        return detail::collect_errors<string_type>(0, [&] { run_in(nullptr, first, last, sources...); });
+    }
+
+    template <class... Sources>
+    error_list try_run(context_type &c, int argc, char_type **argv, Sources const &...sources) const
+    {
+        return detail::collect_errors<string_type>(1, [&] { run_in(&c, argv + 1, argv + argc, sources...); });
+    }
+
+    template <class Iterator, class... Sources>
+    error_list try_run(context_type &c, Iterator first, Iterator last, Sources const &...sources) const
+    {
+        return detail::collect_errors<string_type>(0, [&] { run_in(&c, first, last, sources...); });
+    }
+
+    // Parses many argument vectors against the options at once, without
+    // calling the handlers. Each element of [first, last) is a range of
+    // arguments, which must outlive the result. Response files are not
+    // expanded. With more than one thread, the batch is split among them.
+    template <class Iterator>
+    basic_batch_result<string_type> parse_batch(
+        Iterator first, Iterator last, unsigned threads = 1) const
+    {
+        auto const n = static_cast<std::size_t>(std::distance(first, last));
+        auto const chunks = std::max<std::size_t>(1, std::min<std::size_t>(threads, n));
+        std::vector<basic_batch_result<string_type>> results(chunks);
+        // what a chunk throws, e.g. std::bad_alloc, thrown after all are done
+        std::vector<std::exception_ptr> errors(chunks);
+        std::vector<std::thread> workers;
+        struct join_guard
+        {
+            std::vector<std::thread> &workers;
+
+            void join()
+            {
+                for (auto &w : workers) {
+                    if (w.joinable()) { w.join(); }
+                }
+            }
+
+            ~join_guard() { join(); }
+        } guard = {workers};
+        workers.reserve(chunks - 1);
+        auto chunk_first = first;
+        for (std::size_t k = 0; k < chunks; ++k) {
+            auto const row = n * k / chunks;
+            auto const chunk_last = std::next(chunk_first, n * (k + 1) / chunks - row);
+            auto const parse = [this, &results, &errors, k, chunk_first, chunk_last, row] {
+#if GETOPTMM_HAS_EXCEPTIONS
+                try {
+                    parse_rows(results[k], chunk_first, chunk_last, row);
+                } catch (...) {
+                    errors[k] = std::current_exception();
+                }
+#else
+                static_cast<void>(errors);
+                parse_rows(results[k], chunk_first, chunk_last, row);
+#endif
+            };
+            if (k + 1 < chunks) { workers.emplace_back(parse); }
+            else { parse(); }
+            chunk_first = chunk_last;
+        }
+        guard.join();
+#if GETOPTMM_HAS_EXCEPTIONS
+        for (auto const &e : errors) {
+            if (e) { std::rethrow_exception(e); }
+        }
+#endif
+        for (std::size_t k = 1; k < chunks; ++k) {
+            detail::append(results[0], results[k]);
+        }
+        return std::move(results[0]);
+    }
+
+    // Parses into r without calling the handlers; r is cleared first, and
+    // its capacity is reused. The arguments must outlive r. As with
+    // parse_batch, response files are not expanded, subcommands are not
+    // selected, and unrecognized options are errors.
+    void record(basic_parse_record<string_type> &r, int argc, char_type **argv) const
+    {
+        record_in(r, argv + 1, argv + argc, 1);
+    }
+
+    template <class Iterator>
+    void record(basic_parse_record<string_type> &r, Iterator first, Iterator last) const
+    {
+        record_in(r, first, last, 0);
+    }
+
+    // Calls the handlers for r, as run would for its arguments.
+    void apply(basic_parse_record<string_type> const &r) const
+    {
+        static_assert(std::is_void<Context>::value, "a context is required");
+        apply_in(nullptr, r);
+    }
+
+    void apply(context_type &c, basic_parse_record<string_type> const &r) const
+    {
+        apply_in(&c, r);
+    }
+
+    // Adds a subcommand. The first non-option argument equal to name (not
+    // one read from a response file) selects it, and the arguments after it
+    // are run, in place, by the parser made by factory(), with the same
+    // context. The parser is made on the first run which selects it, so a
+    // command which is not used costs nothing but its name. The sources
+    // given to run are not read for the subcommand.
+    template <class Factory>
+    basic_parser &add_command(string_type name, Factory &&factory)
+    {
+        auto const it = std::lower_bound(
+            m_commands.begin(), m_commands.end(), name,
+            [](command const &c, string_type const &n) { return c.name < n; });
+        if (it != m_commands.end() && it->name == name) {
+            it->parser = detail::lazy_instance<basic_parser>(std::forward<Factory>(factory));
+        } else {
+            m_commands.insert(
+                it, command{std::move(name), detail::lazy_instance<basic_parser>(std::forward<Factory>(factory))});
+        }
+        return *this;
+    }
+
+    // Completes the last of the words [first, last), the arguments after
+    // argv[0] up to the cursor. The candidates are the long names (without
+    // "--") which start with the word after "--" (all for "-"), or the
+    // subcommands which start with a word which is not an option, in order.
+    // There are none for the argument of an option. The words before are
+    // parsed only to skip the arguments of options and to select a
+    // subcommand; no handler is called.
+    template <class Iterator>
+    detail::vector_t<string_type, view_type> complete(Iterator first, Iterator last) const
+    {
+        detail::vector_t<string_type, view_type> candidates;
+        auto const n = std::distance(first, last);
+        if (n == 0) { return candidates; }
+        auto const cursor = std::next(first, n - 1);
+        auto const flag = detail::has_flag(m_flag, parse_flag::posixly_correct) ?
+            parse_flag::posixly_correct : parse_flag::none;
+        auto p = this;
+        for (auto it = first; ; ) {
+            completion_table t = {*p};
+            auto const errors = detail::collect_errors<string_type>(0, [&] {
+                it = detail::parse_arguments<string_type>(t, it, cursor, flag);
+            });
+            if (!t.selected) {
+                for (auto const &e : errors) {
+                    if (e.type == error_type::argument_required) { return candidates; }
+                }
+                break;
+            }
+            p = &t.selected->parser.get();
+        }
+        auto &&word = *cursor;
+        view_type const w(word);
+        auto const dash = GETOPTMM_LITERAL(char_type, "-")[0];
+        if (!w.empty() && w[0] == dash) {
+            auto const d = w.size() >= 2 && w[1] == dash ? 2 : w.size() == 1 ? 1 : 0;
+            if (d == 0) { return candidates; }
+            auto const r = p->m_long_index.prefix_range(w.data() + d, w.data() + w.size());
+            for (auto pos = r.first; pos != r.second; ++pos) {
+                candidates.push_back(p->m_long_index.name_at(pos));
+            }
+        } else {
+            for (auto const &c : p->m_commands) {
+                if (std::mismatch(w.begin(), w.end(), c.name.begin(), c.name.end()).first == w.end()) {
+                    candidates.push_back(c.name);
+                }
+            }
+        }
+        return candidates;
+    }
+
+    // A script which completes the options and the subcommands of program
+    // in shell without running it, e.g. generated at build time. The
+    // parsers of the subcommands are made, but their subcommands are not
+    // completed.
+    string_type completion_script(shell_type shell, string_type const &program) const
+    {
+        std::basic_ostringstream<
+            char_type,
+            typename string_type::traits_type,
+            typename string_type::allocator_type> os;
+        switch (shell) {
+        case shell_type::bash: write_bash_completion(os, program); break;
+        case shell_type::zsh: write_zsh_completion(os, program); break;
+        case shell_type::fish: write_fish_completion(os, program); break;
+        }
+        return os.str();
+    }
+
+    // Writes the lookup tables, the argument types and the help message of
+    // the options as a blob of bytes, which basic_schema reads in place (see
+    // there). The handlers and the subcommands are not saved.
+    template <class OutputIterator>
+    OutputIterator save_schema(OutputIterator out) const
+    {
+        detail::vector_t<string_type, std::pair<char_type, std::size_t>> shorts;
+        for (std::size_t i = 0; i < m_options.size(); ++i) {
+            for (auto c : m_options[i].get_short_names()) {
+                shorts.emplace_back(c, i);
+            }
+        }
+        std::stable_sort(
+            shorts.begin(), shorts.end(),
+            [](auto const &l, auto const &r) {
+                return detail::to_schema_char(l.first) < detail::to_schema_char(r.first);
+            });
+        detail::schema_writer<char_type> w;
+        w.begin(m_options.size());
+        for (auto const &opt : m_options) {
+            w.add_option(opt.get_arg_type());
+        }
+        for (auto it = shorts.begin(); it != shorts.end(); ++it) {
+            if (it != shorts.begin() && std::prev(it)->first == it->first) { w.merge_short(it->second); }
+            else { w.add_short(it->first, it->second); }
+        }
+        for (std::size_t pos = 0; pos < m_long_index.size(); ++pos) {
+            auto const name = m_long_index.name_at(pos);
+            w.add_long(name.data(), name.size(), m_long_index.option_at(pos));
+        }
+        auto const &body = usage_body();
+        return w.finish(body.data(), body.size(), std::move(out));
+    }
+
+    // handler(parse_statistics const &) is called at the end of each run.
+    // Does nothing unless GETOPTMM_INSTRUMENTATION is nonzero.
+    template <class StatisticsHandler>
+    void set_statistics_handler(StatisticsHandler &&handler)
+    {
+#if GETOPTMM_INSTRUMENTATION
+        m_statistics_handler = std::forward<StatisticsHandler>(handler);
+#else
+        static_cast<void>(handler);
+#endif
+    }
+
+    string_type usage_info(string_type const &header) const
+    {
+        auto const &body = usage_body();
+        string_type s;
+        s.reserve(header.size() + 1 + body.size());
+        detail::write_usage(std::back_inserter(s), header, body);
+        return s;
+    }
+
+    template <class OutputIterator, detail::if_output_iterator_t<OutputIterator> * = nullptr>
+    OutputIterator usage_info(OutputIterator out, string_type const &header) const
+    {
+        return detail::write_usage(std::move(out), header, usage_body());
+    }
+
+    std::basic_ostream<char_type, typename string_type::traits_type> &usage_info(
+        std::basic_ostream<char_type, typename string_type::traits_type> &os,
+        string_type const &header) const
+    {
+        return detail::write_usage(os, header, usage_body());
+    }
+
+private:
+    template <class> friend class incremental_parser;
+
+    struct command
+    {
+        string_type name;
+        detail::lazy_instance<basic_parser> parser;
+    };
+
+    // (re)builds the lookup tables of m_options
+    void build()
+    {
+#if GETOPTMM_INSTRUMENTATION
+        auto const start = detail::statistics_clock::now();
+#endif
+        m_occurrence_slots.clear();
+        m_occurrence_count = 0;
+        for (std::size_t i = 0; i < m_options.size(); ++i) {
+            if (m_options[i].get_occurrence() != occurrence_type::accumulate) {
+                m_occurrence_slots.resize(m_options.size(), detail::no_index);
+                m_occurrence_slots[i] = m_occurrence_count++;
+            }
+        }
+        m_short_index = detail::short_name_index<char_type>();
+        m_long_index = detail::long_name_index<string_type>();
+        for (std::size_t i = 0; i < m_options.size(); ++i) {
+            for (auto c : m_options[i].get_short_names()) {
+                m_short_index.insert(c, i);
+            }
+            for (auto const &s : m_options[i].get_long_names()) {
+                m_long_index.insert(s, i);
+            }
+        }
+        m_short_index.build();
+        m_long_index.build();
+        m_usage.reset();
+#if GETOPTMM_INSTRUMENTATION
+        m_construction = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            detail::statistics_clock::now() - start);
+#endif
+    }
+
+    template <class Iterator>
+    void record_in(
+        basic_parse_record<string_type> &r, Iterator first, Iterator last, std::size_t position) const
+    {
+        auto const flag = detail::has_flag(m_flag, parse_flag::posixly_correct) ?
+            parse_flag::posixly_correct : parse_flag::none;
+        detail::error_sink_scope<string_type> throwing(nullptr);
+        r.clear();
+        r.reserve(static_cast<std::size_t>(std::distance(first, last)));
+        record_table t = {*this, r, position};
+        detail::parse_state<string_type> state;
+        detail::invalid_value_scope<string_type> scope;
+        for (; first != last; ++first, ++t.position) {
+            auto &&arg = *first;
+            detail::parse_argument(t, state, view_type(arg), flag);
+        }
+        detail::finish_arguments(state);
+    }
+
+    void apply_in(context_type *c, basic_parse_record<string_type> const &r) const
+    {
+        detail::error_sink_scope<string_type> throwing(nullptr);
+        detail::vector_t<string_type, detail::occurrence<string_type>> occurrences(m_occurrence_count);
+        detail::vector_t<string_type, detail::async_call<string_type>> async;
+        table t = {*this, c, occurrences.data(), nullptr, &async};
+        detail::invalid_value_scope<string_type> scope;
+        // in the order of the positions
+        std::size_t k = 0;
+        std::size_t m = 0;
+        while (k < r.options.size() || m < r.non_options.size()) {
+            if (m == r.non_options.size() ||
+                (k < r.options.size() && r.positions[k] <= r.non_option_positions[m])) {
+                auto const v = r.values[k];
+                if (v.data()) { t.execute(r.options[k], v); }
+                else { t.execute(r.options[k]); }
+                ++k;
+            } else {
+                t.non_option(r.non_options[m++]);
+            }
+        }
+        execute_last(t);
+        detail::join_async<string_type>(async);
+    }
+
+    template <class Iterator, class... Sources>
+    void run_in(context_type *c, Iterator first, Iterator last, Sources const &...sources) const
+    {
+        detail::vector_t<string_type, detail::occurrence<string_type>> occurrences(m_occurrence_count);
+        // the layer (1 for the arguments) in which each option is found first
+        detail::vector_t<string_type, unsigned char> layers(sizeof...(Sources) ? m_options.size() : 0);
+        // the response files, released after the asynchronous handlers,
+        // which are run concurrently and joined at the end
+        detail::response_file_list files;
+        detail::response_file_scope keep(files);
+        detail::vector_t<string_type, detail::async_call<string_type>> async;
+        table t = {*this, c, occurrences.data(), layers.empty() ? nullptr : layers.data(), &async};
+        auto next = first;
+        auto const sink = detail::current_error_sink<string_type>();
+        std::size_t next_index = 0;
+#if GETOPTMM_INSTRUMENTATION
+        detail::run_instrumented(m_statistics_handler, m_construction, [&] {
+            detail::instrumented_table<table> it = {t};
+            next = detail::parse_arguments<string_type>(it, first, last, m_flag);
+            if (sink) { next_index = sink->index; }
+            int const read[] = {0, (read_source(t, sources), 0)...};
+            static_cast<void>(read);
+            execute_last(t);
+            detail::join_async<string_type>(async);
+        });
+#else
+        next = detail::parse_arguments<string_type>(t, first, last, m_flag);
+        if (sink) { next_index = sink->index; }
+        int const read[] = {0, (read_source(t, sources), 0)...};
+        static_cast<void>(read);
+        execute_last(t);
+        detail::join_async<string_type>(async);
+#endif
+        if (t.selected) {
+            if (sink) { sink->index = next_index; }
+            t.selected->parser.get().run_in(c, next, last);
+        }
+    }
+
+    template <class Table, class Source>
+    void read_source(Table &t, Source const &source) const
+    {
+        ++t.layer;
+        auto const sink = detail::current_error_sink<string_type>();
+        source.for_each([&](view_type name, view_type const *value) {
+            if (sink) {
+                sink->token = name;
+                sink->index = detail::no_index;
+            }
+            detail::collect_thrown<string_type>([&] {
+                read_option(t, name, value, detail::is_strict_source<Source>());
+            });
+        });
+    }
+
+    template <class Table>
+    void read_option(Table &t, view_type name, view_type const *value, bool strict) const
+    {
+        auto const m = m_long_index.find(name.data(), name.data() + name.size());
+        if (m.type != match_type::exact) {
+            if (strict) { t.unrec_option(name); }
+            return;
+        }
+        if (m.option == detail::ambiguous_index) {
+            detail::report_error(
+                error_type::ambiguous_option,
+                GETOPTMM_STRING(string_type, "ambiguous option: ") + detail::to_string<string_type>(name));
+            return;
+        }
+        auto const i = m.option;
+        if (t.layers[i] != 0 && t.layers[i] < t.layer) {
+            // found before
+            return;
+        }
+        switch (m_options[i].get_arg_type()) {
+        case arg_type::none:
+            if (value) {
+                // a switch, e.g. MYTOOL_VERBOSE=1
+                auto const is = [&](char_type const *s) { return *value == view_type(s); };
+                if (is(GETOPTMM_LITERAL(char_type, "0")) || is(GETOPTMM_LITERAL(char_type, "false")) ||
+                    is(GETOPTMM_LITERAL(char_type, "no")) || is(GETOPTMM_LITERAL(char_type, "off")) ||
+                    value->empty()) {
+                    return;
+                }
+                if (!(is(GETOPTMM_LITERAL(char_type, "1")) || is(GETOPTMM_LITERAL(char_type, "true")) ||
+                      is(GETOPTMM_LITERAL(char_type, "yes")) || is(GETOPTMM_LITERAL(char_type, "on")))) {
+                    detail::report_error(
+                        error_type::invalid_value,
+                        GETOPTMM_STRING(string_type, "invalid value: ") + detail::to_string<string_type>(*value));
+                    return;
+                }
+            }
+            t.execute(i);
+            break;
+        case arg_type::optional:
+            if (value) { t.execute(i, *value); }
+            else { t.execute(i); }
+            break;
+        case arg_type::required:
+            if (!value) {
+                detail::report_error(
+                    error_type::argument_required,
+                    GETOPTMM_STRING(string_type, "argument required: ") + detail::to_string<string_type>(name));
+                return;
+            }
+            t.execute(i, *value);
+            break;
+        }
+    }
+
+    // Calls the handlers of occurrence_type::last in the order of the options.
+    template <class Table>
+    void execute_last(Table &t) const
+    {
+        if (m_occurrence_count == 0) { return; }
+        auto const sink = detail::current_error_sink<string_type>();
+        for (std::size_t i = 0; i < m_options.size(); ++i) {
+            auto const k = m_occurrence_slots[i];
+            if (k == detail::no_index || m_options[i].get_occurrence() != occurrence_type::last) {
+                continue;
+            }
+            auto const &o = t.occurrences[k];
+            if (!o.given) { continue; }
+            if (sink) {
+                sink->index = o.index;
+                sink->token = o.arg;
+            }
+            view_type const arg = o.arg;
+            detail::collect_thrown<string_type>([&] { t.call(i, o.has_arg ? &arg : nullptr); });
+        }
+    }
+
+    string_type const &usage_body() const
+    {
+        return m_usage.get([this] {
+            std::vector<std::array<string_type, 3>> helps;
+            std::vector<string_type const *> groups;
+            helps.reserve(m_options.size());
+            groups.reserve(m_options.size());
+            for (auto const &opt: m_options) {
+                helps.push_back(opt.usage_info());
+                groups.push_back(&opt.get_group());
+            }
+            return detail::format_usage(helps, groups, m_usage_width);
+        });
+    }
+
+    template <class Iterator>
+    void parse_rows(
+        basic_batch_result<string_type> &r, Iterator first, Iterator last, std::size_t row) const
+    {
+        auto const flag = detail::has_flag(m_flag, parse_flag::posixly_correct) ?
+            parse_flag::posixly_correct : parse_flag::none;
+        r.options.resize(m_options.size());
+        for (; first != last; ++first, ++row) {
+            batch_table t = {*this, r, row};
+            auto &&args = *first;
+            auto errors = detail::collect_errors<string_type>(0, [&] {
+                detail::parse_arguments<string_type>(t, std::begin(args), std::end(args), flag);
+            });
+            r.error_rows.insert(r.error_rows.end(), errors.size(), row);
+            detail::append(r.errors, errors);
+        }
+    }
+
+    command const *find_command(view_type name) const
+    {
+        auto const it = std::lower_bound(
+            m_commands.begin(), m_commands.end(), name,
+            [](command const &c, view_type n) { return view_type(c.name).compare(n) < 0; });
+        return it != m_commands.end() && view_type(it->name) == name ? &*it : nullptr;
+    }
+
+    template <class Ostream>
+    void write_options(Ostream &os) const
+    {
+        auto sep = "";
+        for (auto const &opt : m_options) {
+            for (auto c : opt.get_short_names()) { os << sep << '-' << c; sep = " "; }
+            for (auto const &l : opt.get_long_names()) { os << sep << "--" << l; sep = " "; }
+        }
+    }
+
+    template <class Ostream>
+    void write_commands(Ostream &os, char const *sep) const
+    {
+        for (auto const &c : m_commands) {
+            os << c.name << (&c != &m_commands.back() ? sep : "");
+        }
+    }
+
+    template <class Ostream>
+    static void write_function_name(Ostream &os, string_type const &program)
+    {
+        os << "_";
+        for (auto c : program) {
+            auto const alnum = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+            os << (alnum ? c : char_type('_'));
+        }
+        os << "_complete";
+    }
+
+    // the words before the cursor select a subcommand in $cmd
+    template <class Ostream>
+    void write_command_loop(Ostream &os, char const *words, char const *pattern_open) const
+    {
+        if (m_commands.empty()) { return; }
+        os << "    for w in " << words << "; do\n"
+           << "        case $w in\n"
+           << "        " << pattern_open;
+        write_commands(os, "|");
+        os << ") cmd=$w; break ;;\n"
+           << "        esac\n"
+           << "    done\n";
+    }
+
+    template <class Ostream>
+    void write_bash_completion(Ostream &os, string_type const &program) const
+    {
+        write_function_name(os, program);
+        os << "()\n{\n"
+           << "    local cur=${COMP_WORDS[COMP_CWORD]} cmd= w words\n";
+        write_command_loop(os, "\"${COMP_WORDS[@]:1:COMP_CWORD-1}\"", "");
+        os << "    case $cmd in\n";
+        for (auto const &c : m_commands) {
+            os << "    " << c.name << ") words=\"";
+            c.parser.get().write_options(os);
+            os << "\" ;;\n";
+        }
+        os << "    *) words=\"";
+        write_options(os);
+        os << "\"";
+        if (!m_commands.empty()) {
+            os << "; [[ $cur != -* ]] && words=\"";
+            write_commands(os, " ");
+            os << "\"";
+        }
+        os << " ;;\n"
+           << "    esac\n"
+           << "    COMPREPLY=($(compgen -W \"$words\" -- \"$cur\"))\n"
+           << "}\n"
+           << "complete -o default -F ";
+        write_function_name(os, program);
+        os << ' ' << program << '\n';
+    }
+
+    template <class Ostream>
+    void write_zsh_completion(Ostream &os, string_type const &program) const
+    {
+        os << "#compdef " << program << '\n';
+        write_function_name(os, program);
+        os << "()\n{\n"
+           << "    local cmd= w\n"
+           << "    local -a candidates\n";
+        write_command_loop(os, "${words[2,CURRENT-1]}", "(");
+        os << "    case $cmd in\n";
+        for (auto const &c : m_commands) {
+            os << "    (" << c.name << ") candidates=(";
+            c.parser.get().write_options(os);
+            os << ") ;;\n";
+        }
+        os << "    (*) candidates=(";
+        write_options(os);
+        os << ")";
+        if (!m_commands.empty()) {
+            os << "; [[ $PREFIX != -* ]] && candidates=(";
+            write_commands(os, " ");
+            os << ")";
+        }
+        os << " ;;\n"
+           << "    esac\n"
+           << "    compadd -a candidates || _files\n"
+           << "}\n"
+           << "compdef ";
+        write_function_name(os, program);
+        os << ' ' << program << '\n';
+    }
+
+    template <class Ostream>
+    void write_fish_options(Ostream &os, string_type const &program, string_type const &condition) const
+    {
+        for (auto const &opt : m_options) {
+            os << "complete -c " << program << condition;
+            for (auto c : opt.get_short_names()) { os << " -s " << c; }
+            for (auto const &l : opt.get_long_names()) { os << " -l " << l; }
+            if (opt.get_arg_type() == arg_type::required) { os << " -r"; }
+            if (!opt.get_description().empty()) {
+                os << " -d '";
+                for (auto c : opt.get_description()) {
+                    if (c == char_type('\'') || c == char_type('\\')) { os << '\\'; }
+                    os << c;
+                }
+                os << '\'';
+            }
+            os << '\n';
+        }
+    }
+
+    template <class Ostream>
+    void write_fish_completion(Ostream &os, string_type const &program) const
+    {
+        if (m_commands.empty()) {
+            write_fish_options(os, program, string_type());
+            return;
+        }
+        std::basic_ostringstream<
+            char_type,
+            typename string_type::traits_type,
+            typename string_type::allocator_type> top;
+        top << " -n 'not __fish_seen_subcommand_from ";
+        write_commands(top, " ");
+        top << "'";
+        auto const condition = top.str();
+        os << "complete -c " << program << condition << " -a '";
+        write_commands(os, " ");
+        os << "'\n";
+        write_fish_options(os, program, condition);
+        for (auto const &c : m_commands) {
+            std::basic_ostringstream<
+                char_type,
+                typename string_type::traits_type,
+                typename string_type::allocator_type> cond;
+            cond << " -n '__fish_seen_subcommand_from " << c.name << "'";
+            c.parser.get().write_fish_options(os, program, cond.str());
+        }
+    }
+
+    // skips the words before the one being completed
+    struct completion_table
+    {
+        basic_parser const &p;
+        command const *selected = nullptr;
+
+        std::size_t find_short(char_type c) const
+        {
+            return p.m_short_index.find(c);
+        }
+
+        detail::long_name_match find_long(char_type const *first, char_type const *last) const
+        {
+            return p.m_long_index.find(first, last);
+        }
+
+        view_type long_name_at(std::size_t pos) const
+        {
+            return p.m_long_index.name_at(pos);
+        }
+
+        arg_type get_arg_type(std::size_t i) const
+        {
+            return p.m_options[i].get_arg_type();
+        }
+
+        void execute(std::size_t) {}
+        void execute(std::size_t, view_type) {}
+        void non_option(view_type) {}
+        void unrec_option(view_type) {}
+
+        bool select_command(view_type arg)
+        {
+            selected = p.find_command(arg);
+            return selected;
+        }
+    };
+
+    struct table
+    {
+        basic_parser const &p;
+        context_type *c = nullptr;
+        // one for each option of occurrence_type other than accumulate,
+        // or null to call the handlers for each occurrence
+        detail::occurrence<string_type> *occurrences = nullptr;
+        // one for each option if there are sources, or null
+        unsigned char *layers = nullptr;
+        // the asynchronous handlers to wait for at the end, or null to wait
+        // for each at once
+        detail::vector_t<string_type, detail::async_call<string_type>> *async = nullptr;
+        unsigned char layer = 1;
+        command const *selected = nullptr;
+
+        std::size_t find_short(char_type c) const
+        {
+            return p.m_short_index.find(c);
+        }
+
+        detail::long_name_match find_long(char_type const *first, char_type const *last) const
+        {
+            return p.m_long_index.find(first, last);
+        }
+
+        view_type long_name_at(std::size_t pos) const
+        {
+            return p.m_long_index.name_at(pos);
+        }
+
+        arg_type get_arg_type(std::size_t i) const
+        {
+            return p.m_options[i].get_arg_type();
+        }
+
+        void execute(std::size_t i)
+        {
+            if (layers && !layers[i]) { layers[i] = layer; }
+            if (take(i, nullptr)) { call(i, nullptr); }
+        }
+
+        void execute(std::size_t i, view_type arg)
+        {
+            if (layers && !layers[i]) { layers[i] = layer; }
+            if (take(i, &arg)) { call(i, &arg); }
+        }
+
+        void call(std::size_t i, view_type const *arg) const
+        {
+            auto const &o = p.m_options[i];
+            auto const sink = detail::current_error_sink<string_type>();
+            if (async && !async->empty() && o.get_after_async()) {
+                auto const index = sink ? sink->index : 0;
+                auto const token = sink ? sink->token : view_type();
+                detail::join_async<string_type>(*async);
+                if (sink) {
+                    sink->index = index;
+                    sink->token = token;
+                }
+            }
+            std::future<void> r;
+            if (c) {
+                if (arg) { r = o.execute(*c, *arg); }
+                else { r = o.execute(*c); }
+            } else {
+                if (arg) { r = o.execute(*arg); }
+                else { r = o.execute(); }
+            }
+            if (!r.valid()) { return; }
+            if (!async) {
+                r.get();
+                return;
+            }
+            async->push_back({
+                std::move(r), sink ? sink->index : 0,
+                sink ? detail::to_string<string_type>(sink->token) : string_type()});
+        }
+
+        // Whether to call the handler for this occurrence now.
+        bool take(std::size_t i, view_type const *arg)
+        {
+            if (!occurrences || p.m_occurrence_slots.empty()) { return true; }
+            auto const k = p.m_occurrence_slots[i];
+            if (k == detail::no_index) { return true; }
+            auto &o = occurrences[k];
+            auto const given = o.given;
+            o.given = true;
+            switch (p.m_options[i].get_occurrence()) {
+            case occurrence_type::first:
+                return !given;
+            case occurrence_type::last:
+                o.has_arg = arg != nullptr;
+                if (arg) { o.arg.assign(arg->data(), arg->size()); }
+                if (auto const sink = detail::current_error_sink<string_type>()) {
+                    o.index = sink->index;
+                }
+                return false;
+            case occurrence_type::unique:
+                if (given) {
+                    auto const &opt = p.m_options[i];
+                    detail::report_error(
+                        error_type::duplicate_option,
+                        opt.get_long_names().empty() ?
+                            GETOPTMM_STRING(string_type, "duplicate option: -") + opt.get_short_names().front() :
+                            GETOPTMM_STRING(string_type, "duplicate option: --") + opt.get_long_names().front());
+                    return false;
+                }
+                return true;
+            default:
+                return true;
+            }
+        }
+
+        void non_option(view_type arg)
+        {
+            p.m_non_option_handler(c, arg);
+        }
+
+        void unrec_option(view_type arg)
+        {
+            p.m_unrec_option_handler(c, arg);
+        }
+
+        bool select_command(view_type arg)
+        {
+            if (p.m_commands.empty()) { return false; }
+            selected = p.find_command(arg);
+            return selected;
+        }
+    };
+
+    // records the options into a basic_parse_record
+    struct record_table
+    {
+        basic_parser const &p;
+        basic_parse_record<string_type> &r;
+        std::size_t position;
+
+        std::size_t find_short(char_type c) const
+        {
+            return p.m_short_index.find(c);
+        }
+
+        detail::long_name_match find_long(char_type const *first, char_type const *last) const
+        {
+            return p.m_long_index.find(first, last);
+        }
+
+        view_type long_name_at(std::size_t pos) const
+        {
+            return p.m_long_index.name_at(pos);
+        }
+
+        arg_type get_arg_type(std::size_t i) const
+        {
+            return p.m_options[i].get_arg_type();
+        }
+
+        void execute(std::size_t i)
+        {
+            execute(i, view_type());
+        }
+
+        void execute(std::size_t i, view_type arg)
+        {
+            r.options.push_back(i);
+            r.values.push_back(arg);
+            r.positions.push_back(position);
+        }
+
+        void non_option(view_type arg)
+        {
+            r.non_options.push_back(arg);
+            r.non_option_positions.push_back(position);
+        }
+
+        void unrec_option(view_type arg)
+        {
+            detail::throw_unrec_option<string_type>()(arg);
+        }
+    };
+
+    // records the options into the columns of a batch
+    struct batch_table
+    {
+        basic_parser const &p;
+        basic_batch_result<string_type> &r;
+        std::size_t row;
+
+        std::size_t find_short(char_type c) const
+        {
+            return p.m_short_index.find(c);
+        }
+
+        detail::long_name_match find_long(char_type const *first, char_type const *last) const
+        {
+            return p.m_long_index.find(first, last);
+        }
+
+        view_type long_name_at(std::size_t pos) const
+        {
+            return p.m_long_index.name_at(pos);
+        }
+
+        arg_type get_arg_type(std::size_t i) const
+        {
+            return p.m_options[i].get_arg_type();
+        }
+
+        void execute(std::size_t i)
+        {
+            execute(i, view_type());
+        }
+
+        void execute(std::size_t i, view_type arg)
+        {
+            r.options[i].rows.push_back(row);
+            r.options[i].values.push_back(arg);
+        }
+
+        void non_option(view_type arg)
+        {
+            r.non_options.rows.push_back(row);
+            r.non_options.values.push_back(arg);
+        }
+
+        void unrec_option(view_type arg)
+        {
+            detail::throw_unrec_option<string_type>()(arg);
+        }
+    };
+
+    detail::vector_t<string_type, option_type> m_options;
+    // m_occurrence_slots[i]: the index of the occurrence of option i, if it
+    // is not accumulate (empty if none is)
+    detail::vector_t<string_type, std::size_t> m_occurrence_slots;
+    std::size_t m_occurrence_count = 0;
+    detail::short_name_index<char_type> m_short_index;
+    detail::long_name_index<string_type> m_long_index;
+    detail::small_function<void (context_type *, view_type)> m_non_option_handler;
+    detail::small_function<void (context_type *, view_type)> m_unrec_option_handler;
+    parse_flag m_flag;
+    std::size_t m_usage_width = 0;
+    detail::usage_cache<string_type> m_usage;
+    // sorted by name
+    detail::vector_t<string_type, command> m_commands;
+#if GETOPTMM_INSTRUMENTATION
+    detail::small_function<void (parse_statistics const &)> m_statistics_handler;
+    std::chrono::nanoseconds m_construction{};
+#endif
+};
+
+using parser = basic_parser<std::string>;
+using wparser = basic_parser<std::wstring>;
+
+template <class Char, class ArgTag>
+struct static_option_t
+{
+    Char short_name;
+    Char const *long_name;
+    Char const *arg_name;
+    Char const *description;
+};
+
+// Describes an option of static_parser. Each option has at most one short
+// name and one long name; {} means none.
+template <class Char>
+constexpr static_option_t<Char, no_arg_t> static_option(
+    Char short_name, Char const *long_name, no_arg_t, Char const *description)
+{
+    return {short_name, long_name, nullptr, description};
+}
+
+template <class Char>
+constexpr static_option_t<Char, optional_arg_t> static_option(
+    Char short_name, Char const *long_name, optional_arg_t,
+    Char const *arg_name, Char const *description)
+{
+    return {short_name, long_name, arg_name, description};
+}
+
+template <class Char>
+constexpr static_option_t<Char, required_arg_t> static_option(
+    Char short_name, Char const *long_name, required_arg_t,
+    Char const *arg_name, Char const *description)
+{
+    return {short_name, long_name, arg_name, description};
+}
+
+namespace detail {
+
+    template <std::size_t I, class T>
+    struct indexed
+    {
+        T value;
+    };
+
+    // A flat alternative to std::tuple, which is cheap to instantiate with
+    // hundreds of elements.
+    template <class Indices, class... Ts>
+    struct indexed_set;
+
+    template <std::size_t... Is, class... Ts>
+    struct indexed_set<std::index_sequence<Is...>, Ts...>
+      : indexed<Is, Ts>...
+    {
+        static constexpr std::size_t size = sizeof...(Ts);
+
+        constexpr explicit indexed_set(Ts... ts)
+          : indexed<Is, Ts>{std::move(ts)}...
+        {}
+    };
+
+    template <std::size_t I, class T>
+    constexpr T &get(indexed<I, T> &e) noexcept
+    {
+        return e.value;
+    }
+
+    template <std::size_t I, class T>
+    T indexed_type(indexed<I, T> const &);
+
+    constexpr arg_type to_arg_type(no_arg_t) { return arg_type::none; }
+    constexpr arg_type to_arg_type(optional_arg_t) { return arg_type::optional; }
+    constexpr arg_type to_arg_type(required_arg_t) { return arg_type::required; }
+
+    template <class Char>
+    constexpr std::size_t static_length(Char const *s)
+    {
+        std::size_t n = 0;
+        if (s) {
+            while (s[n] != Char()) { ++n; }
+        }
+        return n;
+    }
+
+    template <class Char>
+    constexpr int static_compare(Char const *l, std::size_t ln, Char const *r, std::size_t rn)
+    {
+        for (std::size_t i = 0; i < ln && i < rn; ++i) {
+            if (l[i] < r[i]) { return -1; }
+            if (r[i] < l[i]) { return 1; }
+        }
+        return ln < rn ? -1 : rn < ln ? 1 : 0;
+    }
+
+    constexpr std::size_t static_table_size(std::size_t n)
+    {
+        std::size_t size = 1;
+        while (size < n * 2) { size *= 2; }
+        return size;
+    }
+
+    template <class Char>
+    struct static_option_info
+    {
+        Char short_name;
+        Char const *long_name;
+        std::size_t long_size;
+        arg_type type;
+        Char const *arg_name;
+        Char const *description;
+    };
+
+    template <class Char, class ArgTag>
+    constexpr static_option_info<Char> make_static_option_info(static_option_t<Char, ArgTag> const &opt)
+    {
+        return {
+            opt.short_name, opt.long_name, static_length(opt.long_name),
+            to_arg_type(ArgTag()), opt.arg_name, opt.description};
+    }
+
+    template <class Char, std::size_t N, bool = (sizeof(Char) == 1)>
+    class static_short_index
+    {
+    public:
+        constexpr static_short_index()
+        {
+            for (auto &e : m_table) { e = no_index; }
+        }
+
+        constexpr void insert(Char c, std::size_t index)
+        {
+            auto &e = m_table[static_cast<unsigned char>(c)];
+            e = e == no_index ? index : e != index ? ambiguous_index : e;
+        }
+
+        constexpr void build() {}
+
+        constexpr std::size_t find(Char c) const
+        {
+            return m_table[static_cast<unsigned char>(c)];
+        }
+
+    private:
+        std::size_t m_table[256] = {};
+    };
+
+    template <class T, class Less>
+    constexpr void static_sift_down(T *first, std::size_t root, std::size_t n, Less less)
+    {
+        for (auto child = root * 2 + 1; child < n; root = child, child = root * 2 + 1) {
+            if (child + 1 < n && less(first[child], first[child + 1])) { ++child; }
+            if (!less(first[root], first[child])) { return; }
+            auto const t = first[root];
+            first[root] = first[child];
+            first[child] = t;
+        }
+    }
+
+    // heapsort, since std::sort is not constexpr
+    template <class T, class Less>
+    constexpr void static_sort(T *first, std::size_t n, Less less)
+    {
+        for (auto start = n / 2; start-- > 0; ) {
+            static_sift_down(first, start, n, less);
+        }
+        for (auto end = n; end > 1; ) {
+            --end;
+            auto const t = first[0];
+            first[0] = first[end];
+            first[end] = t;
+            static_sift_down(first, 0, end, less);
+        }
+    }
+
+    template <class Char, std::size_t N>
+    class static_short_index<Char, N, false>
+    {
+    public:
+        constexpr void insert(Char c, std::size_t index)
+        {
+            m_names[m_size] = c;
+            m_indices[m_size] = index;
+            ++m_size;
+        }
+
+        constexpr void build()
+        {
+            std::size_t order[N + 1] = {};
+            for (std::size_t i = 0; i < m_size; ++i) { order[i] = i; }
+            static_sort(order, m_size, less{m_names});
+            Char names[N + 1] = {};
+            std::size_t indices[N + 1] = {};
+            std::size_t size = 0;
+            for (std::size_t k = 0; k < m_size; ++k) {
+                auto const i = order[k];
+                if (size > 0 && names[size - 1] == m_names[i]) {
+                    auto &e = indices[size - 1];
+                    e = e != m_indices[i] ? ambiguous_index : e;
+                } else {
+                    names[size] = m_names[i];
+                    indices[size] = m_indices[i];
+                    ++size;
+                }
+            }
+            for (std::size_t k = 0; k < size; ++k) {
+                m_names[k] = names[k];
+                m_indices[k] = indices[k];
+            }
+            m_size = size;
+        }
+
+        constexpr std::size_t find(Char c) const
+        {
+            std::size_t lo = 0;
+            auto hi = m_size;
+            while (lo < hi) {
+                auto const mid = lo + (hi - lo) / 2;
+                if (m_names[mid] < c) { lo = mid + 1; }
+                else { hi = mid; }
+            }
+            return lo < m_size && m_names[lo] == c ? m_indices[lo] : no_index;
+        }
+
+    private:
+        struct less
+        {
+            Char const *names;
+
+            constexpr bool operator()(std::size_t l, std::size_t r) const
+            {
+                // stable, so that the first option comes first
+                return names[l] < names[r] || (names[l] == names[r] && l < r);
+            }
+        };
+
+        Char m_names[N + 1] = {};
+        std::size_t m_indices[N + 1] = {};
+        std::size_t m_size = 0;
+    };
+
+    constexpr std::size_t mix_hash(std::size_t h)
+    {
+        // the finalizer of MurmurHash3
+        h ^= h >> (sizeof(std::size_t) * 4);
+        h *= sizeof(std::size_t) == 8 ?
+            static_cast<std::size_t>(0xff51afd7ed558ccdull) : 0x85ebca6bu;
+        h ^= h >> (sizeof(std::size_t) * 4 - 1);
+        return h;
+    }
+
+    // The compile-time counterpart of long_name_index. Exact matches are found
+    // by a perfect hash (hash and displace), built when the spec is compiled.
+    template <class Char, std::size_t N>
+    class static_long_index
+    {
+    public:
+        static constexpr std::size_t table_size = static_table_size(N);
+        static constexpr std::size_t bucket_count = table_size / 2;
+
+        constexpr void insert(Char const *name, std::size_t size, std::size_t index)
+        {
+            m_names[m_size] = name;
+            m_sizes[m_size] = size;
+            m_options[m_size] = index;
+            ++m_size;
+        }
+
+        constexpr void build()
+        {
+            // sort the names and merge the duplicates
+            std::size_t order[N + 1] = {};
+            for (std::size_t i = 0; i < m_size; ++i) { order[i] = i; }
+            static_sort(order, m_size, less{m_names, m_sizes});
+            Char const *names[N + 1] = {};
+            std::size_t sizes[N + 1] = {};
+            std::size_t options[N + 1] = {};
+            std::size_t size = 0;
+            for (std::size_t k = 0; k < m_size; ++k) {
+                auto const i = order[k];
+                if (size > 0 &&
+                    static_compare(names[size - 1], sizes[size - 1], m_names[i], m_sizes[i]) == 0) {
+                    auto &e = options[size - 1];
+                    e = e != m_options[i] ? ambiguous_index : e;
+                } else {
+                    names[size] = m_names[i];
+                    sizes[size] = m_sizes[i];
+                    options[size] = m_options[i];
+                    ++size;
+                }
+            }
+            m_size = size;
+            for (std::size_t k = 0; k < m_size; ++k) {
+                m_names[k] = names[k];
+                m_sizes[k] = sizes[k];
+                m_options[k] = options[k];
+                m_hashes[k] = hash_range(names[k], names[k] + sizes[k]);
+            }
+            for (auto k = m_size; k-- > 0; ) {
+                m_run_last[k] = k + 1 < m_size && m_options[k + 1] == m_options[k] ? m_run_last[k + 1] : k + 1;
+            }
+            build_perfect_hash();
+        }
+
+        template <class Iterator>
+        constexpr long_name_match find(Iterator first, Iterator last) const
+        {
+            std::size_t const size = last - first;
+            auto const h = hash_range(first, last);
+            auto const i = m_slots[slot_of(h, m_displacements[h & (bucket_count - 1)])];
+            if (i != no_index && static_compare(m_names[i], m_sizes[i], &*first, size) == 0) {
+                return {match_type::exact, m_options[i], 0, 0};
+            }
+
+            std::size_t lo = 0;
+            auto hi = m_size;
+            while (lo < hi) {
+                auto const mid = lo + (hi - lo) / 2;
+                if (static_compare(m_names[mid], m_sizes[mid], &*first, size) < 0) { lo = mid + 1; }
+                else { hi = mid; }
+            }
+            auto const l = lo;
+            hi = m_size;
+            while (lo < hi) {
+                auto const mid = lo + (hi - lo) / 2;
+                if (m_sizes[mid] >= size && static_compare(m_names[mid], size, &*first, size) == 0) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            auto const u = lo;
+            if (l == u) {
+                return {match_type::none, no_index, 0, 0};
+            }
+            return {match_type::partial, m_run_last[l] < u ? ambiguous_index : m_options[l], l, u};
+        }
+
+        constexpr basic_string_view<Char> name_at(std::size_t pos) const
+        {
+            return {m_names[pos], m_sizes[pos]};
+        }
+
+        constexpr std::size_t option_at(std::size_t pos) const
+        {
+            return m_options[pos];
+        }
+
+    private:
+        struct less
+        {
+            Char const *const *names;
+            std::size_t const *sizes;
+
+            constexpr bool operator()(std::size_t l, std::size_t r) const
+            {
+                auto const c = static_compare(names[l], sizes[l], names[r], sizes[r]);
+                return c < 0 || (c == 0 && l < r);
+            }
+        };
+
+        static constexpr std::size_t slot_of(std::size_t h, std::size_t d)
+        {
+            return mix_hash(h + d * (sizeof(std::size_t) == 8 ?
+                static_cast<std::size_t>(0x9e3779b97f4a7c15ull) : 0x9e3779b9u)) & (table_size - 1);
+        }
+
+        constexpr void build_perfect_hash()
+        {
+            // group the names by bucket
+            std::size_t counts[bucket_count + 1] = {};
+            for (std::size_t k = 0; k < m_size; ++k) {
+                ++counts[(m_hashes[k] & (bucket_count - 1)) + 1];
+            }
+            std::size_t max_count = 0;
+            for (std::size_t b = 0; b < bucket_count; ++b) {
+                max_count = counts[b + 1] > max_count ? counts[b + 1] : max_count;
+                counts[b + 1] += counts[b];
+            }
+            std::size_t members[N + 1] = {};
+            std::size_t filled[bucket_count + 1] = {};
+            for (std::size_t k = 0; k < m_size; ++k) {
+                auto const b = m_hashes[k] & (bucket_count - 1);
+                members[counts[b] + filled[b]++] = k;
+            }
+
+            // place larger buckets first, finding a displacement for each
+            for (auto &slot : m_slots) { slot = no_index; }
+            for (auto n = max_count; n > 0; --n) {
+                for (std::size_t b = 0; b < bucket_count; ++b) {
+                    if (counts[b + 1] - counts[b] == n) {
+                        place_bucket(members + counts[b], n, b);
+                    }
+                }
+            }
+        }
+
+        constexpr void place_bucket(std::size_t const *members, std::size_t n, std::size_t b)
+        {
+            for (std::size_t d = 0; ; ++d) {
+                auto ok = true;
+                for (std::size_t j = 0; ok && j < n; ++j) {
+                    auto const slot = slot_of(m_hashes[members[j]], d);
+                    ok = m_slots[slot] == no_index;
+                    for (std::size_t k = 0; ok && k < j; ++k) {
+                        ok = slot_of(m_hashes[members[k]], d) != slot;
+                    }
+                }
+                if (ok) {
+                    m_displacements[b] = d;
+                    for (std::size_t j = 0; j < n; ++j) {
+                        m_slots[slot_of(m_hashes[members[j]], d)] = members[j];
+                    }
+                    return;
+                }
+            }
+        }
+
+        // the names in sorted order
+        Char const *m_names[N + 1] = {};
+        std::size_t m_sizes[N + 1] = {};
+        std::size_t m_options[N + 1] = {};
+        std::size_t m_hashes[N + 1] = {};
+        std::size_t m_size = 0;
+        // m_run_last[k]: the end of the run of names of the same option
+        std::size_t m_run_last[N + 1] = {};
+        std::size_t m_slots[table_size] = {};
+        std::size_t m_displacements[bucket_count] = {};
+    };
+
+} // namespace detail
+
+// A set of options whose lookup tables are built at compile time. Define it
+// as a constexpr variable:
+//   constexpr auto spec = make_static_spec(static_option(...), ...);
+template <class Char, class... ArgTags>
+class basic_static_spec
+{
+public:
+    using char_type = Char;
+    using arg_tags = detail::indexed_set<std::index_sequence_for<ArgTags...>, ArgTags...>;
+
+    static constexpr std::size_t size = sizeof...(ArgTags);
+
+    constexpr basic_static_spec(static_option_t<Char, ArgTags> const &...options)
+    {
+        detail::static_option_info<Char> const infos[] = {
+            detail::make_static_option_info(options)..., {}};
+        for (std::size_t i = 0; i < size; ++i) {
+            m_options[i] = infos[i];
+            if (infos[i].short_name != Char()) {
+                m_short_index.insert(infos[i].short_name, i);
+            }
+            if (infos[i].long_name) {
+                m_long_index.insert(infos[i].long_name, infos[i].long_size, i);
+            }
+        }
+        m_short_index.build();
+        m_long_index.build();
+    }
+
+    constexpr detail::static_option_info<Char> const &option(std::size_t i) const
+    {
+        return m_options[i];
+    }
+
+    constexpr std::size_t find_short(Char c) const
+    {
+        return m_short_index.find(c);
+    }
+
+    template <class Iterator>
+    constexpr detail::long_name_match find_long(Iterator first, Iterator last) const
+    {
+        return m_long_index.find(first, last);
+    }
+
+    constexpr basic_string_view<Char> long_name_at(std::size_t pos) const
+    {
+        return m_long_index.name_at(pos);
+    }
+
+private:
+    detail::static_option_info<Char> m_options[size + 1] = {};
+    detail::static_short_index<Char, size> m_short_index;
+    detail::static_long_index<Char, size> m_long_index;
+};
+
+template <class Char, class... ArgTags>
+constexpr basic_static_spec<Char, ArgTags...> make_static_spec(
+    static_option_t<Char, ArgTags> const &...options)
+{
+    return {options...};
+}
+
+// A parser over a basic_static_spec. Handlers are given in the order of the
+// options and dispatched without type erasure.
+template <class Spec, class Handlers, class NonOptionHandler, class UnrecOptionHandler>
+class static_parser
+{
+public:
+    using char_type = typename Spec::char_type;
+    using string_type = std::basic_string<char_type>;
+    using view_type = basic_string_view<char_type>;
+    using error = basic_parse_error<string_type>;
+
+    static_parser(
+        Spec const &spec,
+        Handlers handlers,
+        NonOptionHandler non_option_handler,
+        UnrecOptionHandler unrec_option_handler,
+        parse_flag flag = parse_flag::none)
+      : m_spec(spec),
+        m_handlers(std::move(handlers)),
+        m_non_option_handler(std::move(non_option_handler)),
+        m_unrec_option_handler(std::move(unrec_option_handler)),
+        m_flag(flag)
+    {}
+
+    void run(int argc, char_type **argv)
+    {
+        run(argv + 1, argv + argc);
+    }
+
+    template <class Iterator>
+    void run(Iterator first, Iterator last)
+    {
+        detail::error_sink_scope<string_type> throwing(nullptr);
+        table t = {*this};
+        detail::parse_arguments<string_type>(t, first, last, m_flag);
+    }
+
+    // see basic_parser::set_usage_width
+    static_parser &set_usage_width(std::size_t width)
+    {
+        m_usage_width = width;
+        m_usage.reset();
+        return *this;
+    }
+
+    string_type usage_info(string_type const &header) const
+    {
+        auto const &body = usage_body();
+        string_type s;
+        s.reserve(header.size() + 1 + body.size());
+        detail::write_usage(std::back_inserter(s), header, body);
+        return s;
+    }
+
+    template <class OutputIterator, detail::if_output_iterator_t<OutputIterator> * = nullptr>
+    OutputIterator usage_info(OutputIterator out, string_type const &header) const
+    {
+        return detail::write_usage(std::move(out), header, usage_body());
+    }
+
+    std::basic_ostream<char_type, typename string_type::traits_type> &usage_info(
+        std::basic_ostream<char_type, typename string_type::traits_type> &os,
+        string_type const &header) const
+    {
+        return detail::write_usage(os, header, usage_body());
+    }
+
+private:
+    template <class> friend class incremental_parser;
+
+    string_type const &usage_body() const
+    {
+        return m_usage.get([this] {
+            std::vector<std::array<string_type, 3>> helps;
+            helps.reserve(Spec::size);
+            for (std::size_t i = 0; i < Spec::size; ++i) {
+                auto const &opt = m_spec.option(i);
+                std::vector<view_type> long_names;
+                if (opt.long_name) { long_names.emplace_back(opt.long_name, opt.long_size); }
+                helps.push_back(
+                    detail::usage_info<string_type>(
+                        view_type(&opt.short_name, opt.short_name != char_type() ? 1 : 0),
+                        long_names, opt.type,
+                        view_type(opt.arg_name ? opt.arg_name : &opt.short_name,
+                            detail::static_length(opt.arg_name)),
+                        string_type(opt.description ? opt.description : &opt.short_name,
+                            detail::static_length(opt.description))));
+            }
+            return detail::format_usage(helps, {}, m_usage_width);
+        });
+    }
+
+    template <std::size_t I>
+    using index_constant = std::integral_constant<std::size_t, I>;
+
+    template <std::size_t I>
+    using arg_tag = decltype(detail::indexed_type<I>(std::declval<typename Spec::arg_tags const &>()));
+
+    template <class Handler>
+    void call(Handler &h, view_type const *, no_arg_t)
+    {
+        h();
+    }
+
+    template <class Handler>
+    void call(Handler &h, view_type const *arg, optional_arg_t)
+    {
+        if (arg) { detail::call_with_arg<string_type>(h, *arg); }
+        else { h(); }
+    }
+
+    template <class Handler>
+    void call(Handler &h, view_type const *arg, required_arg_t)
+    {
+        assert(arg);
+        detail::call_with_arg<string_type>(h, *arg);
+    }
+
+    // binary search over [Lo, Hi), which the compiler can make a jump table
+    template <std::size_t Lo, std::size_t Hi>
+    void dispatch(std::size_t i, view_type const *arg)
+    {
+        dispatch<Lo, Hi>(i, arg, index_constant<(Hi - Lo > 1 ? 2 : Hi - Lo)>());
+    }
+
+    template <std::size_t Lo, std::size_t Hi>
+    void dispatch(std::size_t, view_type const *, index_constant<0>)
+    {
+        assert(false);
+    }
+
+    template <std::size_t Lo, std::size_t Hi>
+    void dispatch(std::size_t, view_type const *arg, index_constant<1>)
+    {
+        call(detail::get<Lo>(m_handlers), arg, arg_tag<Lo>());
+    }
+
+    template <std::size_t Lo, std::size_t Hi>
+    void dispatch(std::size_t i, view_type const *arg, index_constant<2>)
+    {
+        constexpr auto mid = Lo + (Hi - Lo) / 2;
+        if (i < mid) { dispatch<Lo, mid>(i, arg); }
+        else { dispatch<mid, Hi>(i, arg); }
+    }
+
+    struct table
+    {
+        static_parser &p;
+
+        std::size_t find_short(char_type c) const
+        {
+            return p.m_spec.find_short(c);
+        }
+
+        detail::long_name_match find_long(char_type const *first, char_type const *last) const
+        {
+            return p.m_spec.find_long(first, last);
+        }
+
+        view_type long_name_at(std::size_t pos) const
+        {
+            return p.m_spec.long_name_at(pos);
+        }
+
+        arg_type get_arg_type(std::size_t i) const
+        {
+            return p.m_spec.option(i).type;
+        }
+
+        void execute(std::size_t i)
+        {
+            p.template dispatch<0, Spec::size>(i, nullptr);
+        }
+
+        void execute(std::size_t i, view_type arg)
+        {
+            p.template dispatch<0, Spec::size>(i, &arg);
+        }
+
+        void non_option(view_type arg)
+        {
+            detail::call_with_arg<string_type>(p.m_non_option_handler, arg);
+        }
+
+        void unrec_option(view_type arg)
+        {
+            detail::call_with_arg<string_type>(p.m_unrec_option_handler, arg);
+        }
+    };
+
+    Spec const &m_spec;
+    Handlers m_handlers;
+    NonOptionHandler m_non_option_handler;
+    UnrecOptionHandler m_unrec_option_handler;
+    parse_flag m_flag;
+    std::size_t m_usage_width = 0;
+    detail::usage_cache<string_type> m_usage;
+};
+
+template <class... Handlers>
+inline auto static_handlers(Handlers &&...handlers)
+{
+    return detail::indexed_set<
+        std::index_sequence_for<Handlers...>,
+        std::decay_t<Handlers>...>(std::forward<Handlers>(handlers)...);
+}
+
+// spec must outlive the parser.
+template <class Spec, class Handlers, class NonOptionHandler>
+inline auto make_static_parser(
+    Spec const &spec, Handlers &&handlers, NonOptionHandler &&non_option_handler,
+    parse_flag flag = parse_flag::none)
+{
+    using string_type = std::basic_string<typename Spec::char_type>;
+    static_assert(std::decay_t<Handlers>::size == Spec::size, "handlers must match options");
+    return static_parser<
+        Spec, std::decay_t<Handlers>, std::decay_t<NonOptionHandler>,
+        detail::throw_unrec_option<string_type>>(
+        spec, std::forward<Handlers>(handlers),
+        std::forward<NonOptionHandler>(non_option_handler),
+        detail::throw_unrec_option<string_type>(), flag);
+}
+
+template <
+    class Spec, class Handlers, class NonOptionHandler, class UnrecOptionHandler,
+    std::result_of_t<UnrecOptionHandler(std::basic_string<typename Spec::char_type> const &)> * = nullptr>
+inline auto make_static_parser(
+    Spec const &spec, Handlers &&handlers, NonOptionHandler &&non_option_handler,
+    UnrecOptionHandler &&unrec_option_handler, parse_flag flag = parse_flag::none)
+{
+    static_assert(std::decay_t<Handlers>::size == Spec::size, "handlers must match options");
+    return static_parser<
+        Spec, std::decay_t<Handlers>, std::decay_t<NonOptionHandler>,
+        std::decay_t<UnrecOptionHandler>>(
+        spec, std::forward<Handlers>(handlers),
+        std::forward<NonOptionHandler>(non_option_handler),
+        std::forward<UnrecOptionHandler>(unrec_option_handler), flag);
+}
+
+// The options saved by basic_parser::save_schema, read in place from a blob
+// which is embedded in the program or mapped from a file, with no
+// allocation. The blob must be aligned to 4 bytes, outlive the schema and
+// come from a machine of the same byte order; if it is not a schema for
+// Char, valid() is false.
+template <class Char>
+class basic_schema
+{
+public:
+    using char_type = Char;
+    using view_type = basic_string_view<Char>;
+
+    basic_schema(void const *data, std::size_t size) noexcept
+      : m_words(static_cast<std::uint32_t const *>(data))
+    {
+        if (!check(size)) { m_words = nullptr; }
+    }
+
+    bool valid() const noexcept
+    {
+        return m_words != nullptr;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return m_words ? header(detail::schema_option_count_field) : 0;
+    }
+
+    arg_type get_arg_type(std::size_t i) const
+    {
+        return static_cast<arg_type>(options()[i]);
+    }
+
+    std::size_t find_short(Char c) const
+    {
+        auto const first = shorts();
+        auto const n = header(detail::schema_short_count_field);
+        std::size_t lo = 0;
+        std::size_t hi = n;
+        while (lo < hi) {
+            auto const mid = lo + (hi - lo) / 2;
+            if (first[mid * 2] < detail::to_schema_char(c)) { lo = mid + 1; }
+            else { hi = mid; }
+        }
+        return lo < n && first[lo * 2] == detail::to_schema_char(c) ?
+            detail::from_schema_index(first[lo * 2 + 1]) : detail::no_index;
+    }
+
+    template <class Iterator>
+    detail::long_name_match find_long(Iterator first, Iterator last) const
+    {
+        auto const n = header(detail::schema_long_count_field);
+        auto const slots = header(detail::schema_slot_count_field);
+        auto const table = longs() + n * 4;
+        // check keeps a slot empty; the bound is for a blob changed since
+        auto slot = detail::schema_hash(first, last) & (slots - 1);
+        for (std::uint32_t probe = 0; probe < slots; ++probe, slot = (slot + 1) & (slots - 1)) {
+            auto const k = table[slot];
+            if (k == detail::schema_none) { break; }
+            auto const name = long_name_at(k);
+            if (std::equal(first, last, name.begin(), name.end())) {
+                return {match_type::exact, detail::from_schema_index(longs()[k * 4 + 2]), 0, 0};
+            }
+        }
+        std::size_t lo = 0;
+        std::size_t hi = n;
+        while (lo < hi) {
+            auto const mid = lo + (hi - lo) / 2;
+            auto const name = long_name_at(mid);
+            // in the order of long_name_index, which the names are saved in
+            auto const less = std::lexicographical_compare(
+                name.begin(), name.end(), first, last, detail::traits_less<std::char_traits<Char>>());
+            if (less) { lo = mid + 1; }
+            else { hi = mid; }
+        }
+        auto u = lo;
+        while (u < n) {
+            auto const name = long_name_at(u);
+            if (std::mismatch(first, last, name.begin(), name.end()).first != last) { break; }
+            ++u;
+        }
+        if (lo == u) {
+            return {match_type::none, detail::no_index, 0, 0};
+        }
+        auto const option = detail::from_schema_index(longs()[lo * 4 + 2]);
+        return {match_type::partial, longs()[lo * 4 + 3] < u ? detail::ambiguous_index : option, lo, u};
+    }
+
+    view_type long_name_at(std::size_t pos) const
+    {
+        auto const e = longs() + pos * 4;
+        return {chars() + e[0], e[1]};
+    }
+
+    // the help message, without a header
+    view_type usage_body() const
+    {
+        return {chars() + header(detail::schema_usage_offset_field), header(detail::schema_usage_size_field)};
+    }
+
+private:
+    std::uint32_t header(std::size_t field) const
+    {
+        return m_words[field];
+    }
+
+    std::uint32_t const *options() const
+    {
+        return m_words + detail::schema_header_size;
+    }
+
+    std::uint32_t const *shorts() const
+    {
+        return options() + header(detail::schema_option_count_field);
+    }
+
+    std::uint32_t const *longs() const
+    {
+        return shorts() + header(detail::schema_short_count_field) * 2;
+    }
+
+    Char const *chars() const
+    {
+        auto const n = header(detail::schema_long_count_field);
+        return reinterpret_cast<Char const *>(longs() + n * 4 + header(detail::schema_slot_count_field));
+    }
+
+    bool check(std::size_t size) const
+    {
+        using namespace detail;
+        if (!m_words || reinterpret_cast<std::uintptr_t>(m_words) % 4 != 0 ||
+            size < schema_header_size * 4 ||
+            header(schema_magic_field) != schema_magic ||
+            header(schema_version_field) != schema_version ||
+            header(schema_char_size_field) != sizeof(Char)) {
+            return false;
+        }
+        auto const options = std::uint64_t(header(schema_option_count_field));
+        auto const n = std::uint64_t(header(schema_long_count_field));
+        auto const slots = std::uint64_t(header(schema_slot_count_field));
+        auto const char_count = std::uint64_t(header(schema_char_count_field));
+        auto const words = schema_header_size + options + header(schema_short_count_field) * std::uint64_t(2) +
+            n * 4 + slots;
+        if (slots == 0 || (slots & (slots - 1)) != 0 || slots <= n ||
+            words * 4 + char_count * sizeof(Char) > size ||
+            std::uint64_t(header(schema_usage_offset_field)) + header(schema_usage_size_field) > char_count) {
+            return false;
+        }
+        auto const valid_option = [&](std::uint32_t i) {
+            return i < options || i == schema_none || i == schema_ambiguous;
+        };
+        for (std::uint32_t k = 0; k < header(schema_short_count_field); ++k) {
+            if (!valid_option(shorts()[k * 2 + 1])) { return false; }
+        }
+        for (std::uint64_t k = 0; k < n; ++k) {
+            auto const e = longs() + k * 4;
+            if (std::uint64_t(e[0]) + e[1] > char_count || !valid_option(e[2]) || e[3] <= k || e[3] > n) {
+                return false;
+            }
+        }
+        // at most one slot for each name, so that a probe ends at an empty one
+        auto const table = longs() + n * 4;
+        std::uint64_t filled = 0;
+        for (std::uint64_t k = 0; k < slots; ++k) {
+            if (table[k] == schema_none) { continue; }
+            if (table[k] >= n || ++filled > n) { return false; }
+        }
+        for (std::uint64_t i = 0; i < options; ++i) {
+            if (this->options()[i] > static_cast<std::uint32_t>(arg_type::required)) { return false; }
+        }
+        return true;
+    }
+
+    std::uint32_t const *m_words;
+};
+
+using schema = basic_schema<char>;
+using wschema = basic_schema<wchar_t>;
+
+// A parser over a basic_schema. handler(i, arg) is called for the option i
+// (in the order given to the parser which saved the schema), where arg is a
+// pointer to the argument as basic_string_view, or null if there is none.
+template <class Char, class Handler, class NonOptionHandler, class UnrecOptionHandler>
+class schema_parser
+{
+public:
+    using char_type = Char;
+    using string_type = std::basic_string<char_type>;
+    using view_type = basic_string_view<char_type>;
+    using error = basic_parse_error<string_type>;
+
+    schema_parser(
+        basic_schema<Char> const &schema,
+        Handler handler,
+        NonOptionHandler non_option_handler,
+        UnrecOptionHandler unrec_option_handler,
+        parse_flag flag = parse_flag::none)
+      : m_schema(schema),
+        m_handler(std::move(handler)),
+        m_non_option_handler(std::move(non_option_handler)),
+        m_unrec_option_handler(std::move(unrec_option_handler)),
+        m_flag(flag)
+    {
+        assert(schema.valid());
+    }
+
+    void run(int argc, char_type **argv)
+    {
+        run(argv + 1, argv + argc);
+    }
+
+    template <class Iterator>
+    void run(Iterator first, Iterator last)
+    {
+        detail::error_sink_scope<string_type> throwing(nullptr);
+        table t = {*this};
+        detail::parse_arguments<string_type>(t, first, last, m_flag);
+    }
+
+    string_type usage_info(string_type const &header) const
+    {
+        auto const body = m_schema.usage_body();
+        string_type s;
+        s.reserve(header.size() + 1 + body.size());
+        detail::write_usage(std::back_inserter(s), header, body);
+        return s;
+    }
+
+    template <class OutputIterator, detail::if_output_iterator_t<OutputIterator> * = nullptr>
+    OutputIterator usage_info(OutputIterator out, string_type const &header) const
+    {
+        return detail::write_usage(std::move(out), header, m_schema.usage_body());
+    }
+
+    std::basic_ostream<char_type, typename string_type::traits_type> &usage_info(
+        std::basic_ostream<char_type, typename string_type::traits_type> &os,
+        string_type const &header) const
+    {
+        return detail::write_usage(os, header, m_schema.usage_body());
+    }
+
+private:
+    template <class> friend class incremental_parser;
+
+    struct table
+    {
+        schema_parser &p;
+
+        std::size_t find_short(char_type c) const
+        {
+            return p.m_schema.find_short(c);
+        }
+
+        detail::long_name_match find_long(char_type const *first, char_type const *last) const
+        {
+            return p.m_schema.find_long(first, last);
+        }
+
+        view_type long_name_at(std::size_t pos) const
+        {
+            return p.m_schema.long_name_at(pos);
+        }
+
+        arg_type get_arg_type(std::size_t i) const
+        {
+            return p.m_schema.get_arg_type(i);
+        }
+
+        void execute(std::size_t i)
+        {
+            p.m_handler(i, static_cast<view_type const *>(nullptr));
+        }
+
+        void execute(std::size_t i, view_type arg)
+        {
+            p.m_handler(i, &arg);
+        }
+
+        void non_option(view_type arg)
+        {
+            detail::call_with_arg<string_type>(p.m_non_option_handler, arg);
+        }
+
+        void unrec_option(view_type arg)
+        {
+            detail::call_with_arg<string_type>(p.m_unrec_option_handler, arg);
+        }
+    };
+
+    basic_schema<Char> m_schema;
+    Handler m_handler;
+    NonOptionHandler m_non_option_handler;
+    UnrecOptionHandler m_unrec_option_handler;
+    parse_flag m_flag;
+};
+
+template <class Char, class Handler, class NonOptionHandler>
+inline auto make_schema_parser(
+    basic_schema<Char> const &schema, Handler &&handler, NonOptionHandler &&non_option_handler,
+    parse_flag flag = parse_flag::none)
+{
+    using string_type = std::basic_string<Char>;
+    return schema_parser<
+        Char, std::decay_t<Handler>, std::decay_t<NonOptionHandler>,
+        detail::throw_unrec_option<string_type>>(
+        schema, std::forward<Handler>(handler),
+        std::forward<NonOptionHandler>(non_option_handler),
+        detail::throw_unrec_option<string_type>(), flag);
+}
+
+template <
+    class Char, class Handler, class NonOptionHandler, class UnrecOptionHandler,
+    std::result_of_t<UnrecOptionHandler(std::basic_string<Char> const &)> * = nullptr>
+inline auto make_schema_parser(
+    basic_schema<Char> const &schema, Handler &&handler, NonOptionHandler &&non_option_handler,
+    UnrecOptionHandler &&unrec_option_handler, parse_flag flag = parse_flag::none)
+{
+    return schema_parser<
+        Char, std::decay_t<Handler>, std::decay_t<NonOptionHandler>,
+        std::decay_t<UnrecOptionHandler>>(
+        schema, std::forward<Handler>(handler),
+        std::forward<NonOptionHandler>(non_option_handler),
+        std::forward<UnrecOptionHandler>(unrec_option_handler), flag);
+}
+
+// Parses arguments pushed one at a time, e.g. as they arrive from a pipe.
+// Each option is dispatched as soon as it is complete, and an option which
+// requires an argument takes the next one fed. The parser must outlive this.
+template <class Parser>
+class incremental_parser
+{
+public:
+    using char_type = typename Parser::char_type;
+    using string_type = typename Parser::string_type;
+    using view_type = typename Parser::view_type;
+    using error = typename Parser::error;
+
+    explicit incremental_parser(Parser &p)
+      : m_parser(p)
+    {}
+
+    void feed(view_type arg)
+    {
+        detail::error_sink_scope<string_type> throwing(nullptr);
+        typename Parser::table t = {m_parser};
+        detail::invalid_value_scope<string_type> scope;
+        detail::transient_scope transient;
+        detail::expand_argument(t, m_state, arg, m_parser.m_flag);
+    }
+
+    // Ends the arguments; throws if an option is still waiting for its
+    // argument. Arguments can be fed again afterwards.
+    void finish()
+    {
+        detail::error_sink_scope<string_type> throwing(nullptr);
+        detail::finish_arguments(m_state);
+    }
+
+private:
+    Parser &m_parser;
+    detail::parse_state<string_type> m_state;
+};
+
+// A basic_parser with a Context gives the handlers the context, which must
+// also outlive this.
+template <class String, class Context>
+class incremental_parser<basic_parser<String, Context>>
+{
+public:
+    using parser_type = basic_parser<String, Context>;
+    using char_type = typename parser_type::char_type;
+    using string_type = typename parser_type::string_type;
+    using view_type = typename parser_type::view_type;
+    using context_type = typename parser_type::context_type;
+    using error = typename parser_type::error;
+
+    explicit incremental_parser(parser_type const &p)
+      : incremental_parser(p, nullptr)
+    {
+        static_assert(std::is_void<Context>::value, "a parser with a Context needs a context");
+    }
+
+    incremental_parser(parser_type const &p, context_type &c)
+      : incremental_parser(p, &c)
+    {}
+
+    // After a subcommand, the arguments fed are those of the subcommand.
+    void feed(view_type arg)
+    {
+        detail::error_sink_scope<string_type> throwing(nullptr);
+        if (m_command) {
+            m_command->feed(arg);
+            return;
+        }
+        auto t = table();
+        {
+            detail::invalid_value_scope<string_type> scope;
+            detail::transient_scope transient;
+            detail::response_file_scope keep(m_files);
+            detail::expand_argument(t, m_state, arg, m_parser.m_flag);
+        }
+        if (t.selected) {
+            // as run does before it runs the subcommand
+            finish_arguments();
+            m_command.reset(new incremental_parser(t.selected->parser.get(), m_context));
+        }
+    }
+
+    // As run does at the end, also calls the handlers of
+    // occurrence_type::last and waits for the asynchronous handlers.
+    void finish()
+    {
+        detail::error_sink_scope<string_type> throwing(nullptr);
+        struct reset_guard
+        {
+            incremental_parser &ip;
+            ~reset_guard()
+            {
+                ip.m_state.stop = false;
+                ip.m_occurrences.assign(ip.m_parser.m_occurrence_count, {});
+                ip.m_async.clear();
+                ip.m_command.reset();
+                ip.m_files.clear();
+            }
+        } guard = {*this};
+        if (m_command) { m_command->finish(); }
+        else { finish_arguments(); }
+    }
+
+private:
+    incremental_parser(parser_type const &p, context_type *c)
+      : m_parser(p),
+        m_context(c),
+        m_occurrences(p.m_occurrence_count)
+    {}
+
+    void finish_arguments()
+    {
+        auto t = table();
+        detail::invalid_value_scope<string_type> scope;
+        detail::finish_arguments(m_state);
+        m_parser.execute_last(t);
+        detail::join_async<string_type>(m_async);
+    }
+
+    typename parser_type::table table()
+    {
+        return {m_parser, m_context, m_occurrences.data(), nullptr, &m_async};
+    }
+
+    parser_type const &m_parser;
+    context_type *m_context = nullptr;
+    detail::parse_state<string_type> m_state;
+    // the response files read, released at finish
+    detail::response_file_list m_files;
+    // kept from feed to feed, as in one run
+    detail::vector_t<string_type, detail::occurrence<string_type>> m_occurrences;
+    detail::vector_t<string_type, detail::async_call<string_type>> m_async;
+    // the subcommand fed, if any
+    std::unique_ptr<incremental_parser> m_command;
+};
+
+template <class Parser>
+inline incremental_parser<std::remove_const_t<Parser>> make_incremental_parser(Parser &p)
+{
+    return incremental_parser<std::remove_const_t<Parser>>(p);
+}
+
+template <class Parser, class Context>
+inline incremental_parser<std::remove_const_t<Parser>> make_incremental_parser(Parser &p, Context &c)
+{
+    return incremental_parser<std::remove_const_t<Parser>>(p, c);
+}
+
+namespace detail {
+
+    template <class T>
+    struct is_number
+      : std::integral_constant<bool,
+            std::is_arithmetic<T>::value &&
+            !std::is_same<T, char>::value &&
+            !std::is_same<T, signed char>::value &&
+            !std::is_same<T, unsigned char>::value &&
+            !std::is_same<T, wchar_t>::value &&
+#ifdef __cpp_char8_t
+            !std::is_same<T, char8_t>::value &&
+#endif
+            !std::is_same<T, char16_t>::value &&
+            !std::is_same<T, char32_t>::value>
+    {};
+
+    enum class conversion_type
+    {
+        ok,
+        invalid,
+        unsupported
+    };
+
+    template <class Char>
+    inline bool skip_sign(Char const *&first, Char const *last)
+    {
+        while (first != last && is_space(*first)) {
+            ++first;
+        }
+        if (first != last && (*first == Char('+') || *first == Char('-'))) {
+            return *first++ == Char('-');
+        }
+        return false;
+    }
+
+    // Same grammar as num_get in the classic locale: optional leading space,
+    // optional sign, decimal digits only. Like strtoul, a minus sign negates
+    // unsigned values.
+    template <class T, class Char>
+    inline conversion_type parse_integer(Char const *first, Char const *last, T &t)
+    {
+        using unsigned_type = std::make_unsigned_t<T>;
+
+        bool const negative = skip_sign(first, last);
+        if (first == last) {
+            return conversion_type::invalid;
+        }
+        unsigned_type const limit = !std::is_signed<T>::value ?
+            std::numeric_limits<unsigned_type>::max() :
+            unsigned_type(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+        unsigned_type v = 0;
+        for (; first != last; ++first) {
+            if (!is_digit(*first)) {
+                return conversion_type::invalid;
+            }
+            auto const d = static_cast<unsigned_type>(*first - Char('0'));
+            if (v > (limit - d) / 10) {
+                return conversion_type::invalid;
+            }
+            v = static_cast<unsigned_type>(v * 10 + d);
+        }
+        if (!negative) {
+            t = static_cast<T>(v);
+        }
+        else if (std::is_signed<T>::value) {
+            t = v == 0 ? T(0) : static_cast<T>(-static_cast<T>(v - 1) - 1);
+        }
+        else {
+            t = static_cast<T>(unsigned_type(0) - v);
+        }
+        return conversion_type::ok;
+    }
+
+    template <class Char>
+    inline conversion_type parse_integer(Char const *first, Char const *last, bool &t)
+    {
+        long v;
+        auto const result = parse_integer(first, last, v);
+        if (result == conversion_type::ok) {
+            if (v != 0 && v != 1) {
+                return conversion_type::invalid;
+            }
+            t = v == 1;
+        }
+        return result;
+    }
+
+    // Largest e such that 10^e is exact in a type with the given number of
+    // mantissa digits.
+    constexpr int max_exact_pow10(int digits)
+    {
+        int e = 0;
+        unsigned long long p = 1;
+        while (e < 27 && (digits >= 64 || (p * 5) >> digits == 0)) {
+            p *= 5;
+            ++e;
+        }
+        return e;
+    }
+
+    // Exact-operand fast path (Clinger): a mantissa and a power of ten that
+    // are both representable give a correctly rounded result in one
+    // operation. Anything else is left to the stream.
+    template <class T, class Char>
+    inline conversion_type parse_floating(Char const *first, Char const *last, T &t)
+    {
+        static constexpr long double pow10[] = {
+            1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L,
+            1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L,
+            1e19L, 1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L
+        };
+        constexpr int digits = std::numeric_limits<T>::digits;
+        constexpr int max_exp = max_exact_pow10(digits);
+
+        bool const negative = skip_sign(first, last);
+        unsigned long long m = 0;
+        int n = 0;
+        int exp = 0;
+        bool mantissa = false;
+        auto const digit = [&](Char c, int scale) {
+            mantissa = true;
+            if (m == 0 && c == Char('0')) {
+                exp += scale;
+                return true;
+            }
+            if (n == 19) {
+                return false;
+            }
+            m = m * 10 + static_cast<unsigned>(c - Char('0'));
+            ++n;
+            exp += scale;
+            return true;
+        };
+        for (; first != last && is_digit(*first); ++first) {
+            if (!digit(*first, 0)) {
+                return conversion_type::unsupported;
+            }
+        }
+        if (first != last && *first == Char('.')) {
+            for (++first; first != last && is_digit(*first); ++first) {
+                if (!digit(*first, -1)) {
+                    return conversion_type::unsupported;
+                }
+            }
+        }
+        if (!mantissa) {
+            return conversion_type::invalid;
+        }
+        if (first != last && (*first == Char('e') || *first == Char('E'))) {
+            ++first;
+            bool const exp_negative = first != last && *first == Char('-');
+            if (first != last && (*first == Char('+') || *first == Char('-'))) {
+                ++first;
+            }
+            if (first == last) {
+                return conversion_type::invalid;
+            }
+            int e = 0;
+            for (; first != last; ++first) {
+                if (!is_digit(*first)) {
+                    return conversion_type::invalid;
+                }
+                if (e < 100000) {
+                    e = e * 10 + (*first - Char('0'));
+                }
+            }
+            exp += exp_negative ? -e : e;
+        }
+        else if (first != last) {
+            return conversion_type::invalid;
+        }
+        if (m == 0) {
+            t = negative ? -T(0) : T(0);
+            return conversion_type::ok;
+        }
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+        if ((digits >= 64 || m >> (digits % 64) == 0) && -max_exp <= exp && exp <= max_exp) {
+            T v = static_cast<T>(m);
+            v = exp < 0 ?
+                v / static_cast<T>(pow10[-exp]) :
+                v * static_cast<T>(pow10[exp]);
+            t = negative ? -v : v;
+            return conversion_type::ok;
+        }
+#else
+        static_cast<void>(max_exp);
+#endif
+        return conversion_type::unsupported;
+    }
+
+    template <class T, class Char>
+    inline std::enable_if_t<std::is_integral<T>::value, conversion_type>
+    parse_number(Char const *first, Char const *last, T &t)
+    {
+        return parse_integer(first, last, t);
+    }
+
+    template <class T, class Char>
+    inline std::enable_if_t<std::is_floating_point<T>::value, conversion_type>
+    parse_number(Char const *first, Char const *last, T &t)
+    {
+        return parse_floating(first, last, t);
+    }
+
+    // The converters set t and return true, or leave t as is and return
+    // false if s is not a valid value.
+    template <class String, class T>
+    struct stream_from_string_t
+    {
+        bool operator()(String const &s, T &t) const
+        {
+            std::basic_stringstream<
+                typename String::value_type,
+                typename String::traits_type,
+                typename String::allocator_type> ss(s);
+            T v;
+            if (!(ss >> v && (ss.peek(), ss.eof()))) {
+                return false;
+            }
+            t = std::move(v);
+            return true;
+        }
+    };
+
+    template <class String, class T, class = void>
+    struct from_string_t : stream_from_string_t<String, T>
+    {};
+
+    template <class String, class T>
+    struct from_string_t<String, T,
+        std::enable_if_t<std::is_convertible<String const &, T>::value>>
+    {
+        bool operator()(String s, T &t) const
+        {
+            t = T(std::move(s));
+            return true;
+        }
+    };
+
+    template <class String, class T>
+    struct from_string_t<String, T, std::enable_if_t<is_number<T>::value>>
+    {
+        using char_type = typename String::value_type;
+
+        bool operator()(String const &s, T &t) const
+        {
+            return (*this)(s.data(), s.data() + s.size(), t);
+        }
+
+        bool operator()(char_type const *first, char_type const *last, T &t) const
+        {
+            switch (parse_number(first, last, t)) {
+            case conversion_type::ok:
+                return true;
+            case conversion_type::unsupported:
+                return stream_from_string_t<String, T>()(String(first, last), t);
+            case conversion_type::invalid:
+                break;
+            }
+            return false;
+        }
+    };
+
+    // Converts s to t, or reports error_type::invalid_value and returns false.
+    template <class T, class String>
+    inline bool try_from_string(String const &s, T &t)
+    {
+        count(&parse_statistics::conversions);
+        if (from_string_t<String, T>()(s, t)) {
+            return true;
+        }
+        report_error(error_type::invalid_value, GETOPTMM_STRING(String, "invalid value: ") + s);
+        return false;
+    }
+
+    template <class T, class Char, class Traits>
+    inline std::enable_if_t<is_number<T>::value, bool>
+    try_from_string(basic_string_view<Char, Traits> s, T &t)
+    {
+        using string_type = std::basic_string<Char, Traits>;
+        count(&parse_statistics::conversions);
+        if (from_string_t<string_type, T>()(s.data(), s.data() + s.size(), t)) {
+            return true;
+        }
+        report_invalid_value(s);
+        return false;
+    }
+
+    template <class String, class T, class View>
+    inline bool from_view(View s, T &t, std::false_type)
+    {
+        return from_string_t<String, T>()(to_string<String>(s), t);
+    }
+
+    // reuses the storage of t
+    template <class String, class View>
+    inline bool from_view(View s, String &t, std::true_type)
+    {
+        t.assign(s.data(), s.size());
+        return true;
+    }
+
+    // T if it is a string of Char, so that its allocator is used
+    template <class T, class Char, class Traits>
+    struct string_for
+    {
+        using type = std::basic_string<Char, Traits>;
+    };
+
+    template <class Char, class Traits, class Allocator>
+    struct string_for<std::basic_string<Char, Traits, Allocator>, Char, Traits>
+    {
+        using type = std::basic_string<Char, Traits, Allocator>;
+    };
+
+    template <class T, class Char, class Traits>
+    using string_for_t = typename string_for<T, Char, Traits>::type;
+
+    template <class T, class Char, class Traits>
+    inline std::enable_if_t<!is_number<T>::value, bool>
+    try_from_string(basic_string_view<Char, Traits> s, T &t)
+    {
+        using string_type = string_for_t<T, Char, Traits>;
+        count(&parse_statistics::conversions);
+        if (from_view<string_type>(s, t, std::is_same<T, string_type>())) {
+            return true;
+        }
+        report_invalid_value(s);
+        return false;
+    }
+
+    template <class T, class String>
+    inline T from_string(String const &s)
+    {
+        T t{};
+        try_from_string(s, t);
+        return t;
+    }
+
+    template <class Container, class Arg>
+    inline void push_back_from_string(Container &c, Arg const &arg, std::true_type)
+    {
+        using string_type = string_for_t<
+            typename Container::value_type, typename Arg::value_type, typename Arg::traits_type>;
+        count(&parse_statistics::conversions);
+        c.push_back(typename Container::value_type(to_string<string_type>(arg)));
+    }
+
+    template <class Container, class Arg>
+    inline void push_back_from_string(Container &c, Arg const &arg, std::false_type)
+    {
+        typename Container::value_type v{};
+        if (try_from_string(arg, v)) {
+            c.push_back(std::move(v));
+        }
+    }
+
+    // Appends arg converted, unless it is invalid.
+    template <class Container, class Arg>
+    inline void push_back_from_string(Container &c, Arg const &arg)
+    {
+        using value_type = typename Container::value_type;
+        using string_type = string_for_t<
+            value_type, typename Arg::value_type, typename Arg::traits_type>;
+        push_back_from_string(
+            c, arg, std::is_convertible<string_type const &, value_type>());
+    }
+
+    struct ignore_t
+    {
+        using view_handler_tag = void;
+
+        template <class... Args>
+        void operator()(Args const &...) const {}
+    };
+
+    template <class T, class U>
+    struct assign_const_t
+    {
+        using view_handler_tag = void;
+
+        T &t;
+        U u;
+
+        void operator()() const { t = u; }
+
+        template <class Arg>
+        void operator()(Arg const &) const { t = u; }
+    };
+
+    template <class T, class U>
+    struct push_back_const_t
+    {
+        using view_handler_tag = void;
+
+        T &t;
+        U u;
+
+        void operator()() const { t.push_back(u); }
+
+        template <class Arg>
+        void operator()(Arg const &) const { t.push_back(u); }
+    };
+
+    template <class T, class U>
+    struct assign_or_t
+    {
+        using view_handler_tag = void;
+
+        T &t;
+        U u;
+
+        void operator()() const { t = u; }
+
+        template <class Arg>
+        void operator()(Arg const &arg) const { try_from_string(arg, t); }
+    };
+
+    template <class T, class U>
+    struct push_back_or_t
+    {
+        using view_handler_tag = void;
+
+        T &t;
+        U u;
+
+        void operator()() const { t.push_back(u); }
+
+        template <class Arg>
+        void operator()(Arg const &arg) const
+        {
+            push_back_from_string(t, arg);
+        }
+    };
+
+    template <class T>
+    struct assign_t
+    {
+        using view_handler_tag = void;
+
+        T &t;
+
+        template <class Arg>
+        void operator()(Arg const &arg) const { try_from_string(arg, t); }
+    };
+
+    template <class T>
+    struct push_back_t
+    {
+        using view_handler_tag = void;
+
+        T &t;
+
+        template <class Arg>
+        void operator()(Arg const &arg) const
+        {
+            push_back_from_string(t, arg);
+        }
+    };
+
+    // Applies make(r.*m) to the arguments, where r is the context.
+    template <class R, class T, class Make>
+    struct member_t
+    {
+        using view_handler_tag = void;
+
+        T R::*m;
+        Make make;
+
+        void operator()(R &r) const { make(r.*m)(); }
+
+        template <class Arg>
+        void operator()(R &r, Arg const &arg) const { make(r.*m)(arg); }
+    };
+
+    template <class R, class T, class Make>
+    inline member_t<R, T, Make> member(T R::*m, Make make)
+    {
+        return {m, make};
+    }
+
+    template <class Lazy>
+    struct lazy_t
+    {
+        using view_handler_tag = void;
+
+        Lazy &l;
+
+        template <class Arg>
+        void operator()(Arg const &arg) const { l.record(arg); }
+    };
+
+} // namespace detail
+
+// The argument of an option, kept as a view in place and converted to T on
+// the first call of get, so that it costs nothing unless it is used (e.g.
+// on --help). The argument must outlive the value, unless it is read from a
+// response file or fed to an incremental_parser, where it is copied.
+template <class T, class Char = char, class Traits = std::char_traits<Char>>
+class basic_lazy_value
+{
+public:
+    using value_type = T;
+    using view_type = basic_string_view<Char, Traits>;
+
+    // value is returned by get unless the option is given
+    explicit basic_lazy_value(T value = T())
+      : m_value(std::move(value))
+    {}
+
+    // Keeps the last argument, as assign does.
+    void record(view_type arg)
+    {
+        if (detail::transient_arguments()) {
+            m_copy = std::make_shared<string_type const>(arg.data(), arg.size());
+            m_view = view_type(m_copy->data(), m_copy->size());
+        } else {
+            m_copy.reset();
+            m_view = arg;
+        }
+        m_given = true;
+        m_converted = false;
+    }
+
+    bool given() const noexcept
+    {
+        return m_given;
+    }
+
+    view_type view() const noexcept
+    {
+        return m_view;
+    }
+
+    // Throws basic_parse_error if the argument is invalid, even in a handler
+    // of try_run.
+    T const &get() const
+    {
+        if (!m_converted) {
+            detail::throwing_conversion_scope<Char, Traits> throwing;
+            m_value = detail::from_string<T>(m_view);
+            m_converted = true;
+        }
+        return m_value;
+    }
+
+private:
+    using string_type = std::basic_string<Char, Traits>;
+
+    view_type m_view;
+    // the argument, if it is copied (shared by copies of this)
+    std::shared_ptr<string_type const> m_copy;
+    bool m_given = false;
+    mutable bool m_converted = true;
+    mutable T m_value;
+};
+
+template <class T>
+using lazy_value = basic_lazy_value<T, char>;
+template <class T>
+using wlazy_value = basic_lazy_value<T, wchar_t>;
+
+// The arguments of an option given many times, as push_back keeps them,
+// converted on the first call of get. Later arguments are converted by the
+// next call.
+template <class T, class Char = char, class Traits = std::char_traits<Char>>
+class basic_lazy_values
+{
+public:
+    using value_type = T;
+    using view_type = basic_string_view<Char, Traits>;
+
+    void record(view_type arg)
+    {
+        if (detail::transient_arguments()) {
+            m_copies.push_back(std::make_shared<string_type const>(arg.data(), arg.size()));
+            arg = view_type(m_copies.back()->data(), m_copies.back()->size());
+        }
+        m_views.push_back(arg);
+    }
+
+    std::size_t size() const noexcept
+    {
+        return m_views.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return m_views.empty();
+    }
+
+    std::vector<view_type> const &views() const noexcept
+    {
+        return m_views;
+    }
+
+    // Throws basic_parse_error if an argument is invalid, even in a handler
+    // of try_run.
+    std::vector<T> const &get() const
+    {
+        detail::throwing_conversion_scope<Char, Traits> throwing;
+        m_values.reserve(m_views.size());
+        while (m_values.size() < m_views.size()) {
+            m_values.push_back(detail::from_string<T>(m_views[m_values.size()]));
+        }
+        return m_values;
+    }
+
+    void clear() noexcept
+    {
+        m_views.clear();
+        m_copies.clear();
+        m_values.clear();
+    }
+
+private:
+    using string_type = std::basic_string<Char, Traits>;
+
+    std::vector<view_type> m_views;
+    // the arguments which are copied
+    std::vector<std::shared_ptr<string_type const>> m_copies;
+    mutable std::vector<T> m_values;
+};
+
+template <class T>
+using lazy_values = basic_lazy_values<T, char>;
+template <class T>
+using wlazy_values = basic_lazy_values<T, wchar_t>;
+
+constexpr detail::ignore_t ignore = {};
+
+template <class T, class U>
+inline auto assign_const(T &t, U &&u)
+{
+    return detail::assign_const_t<T, std::decay_t<U>>{t, std::forward<U>(u)};
+}
+
+template <class T>
+inline auto assign_true(T &t) { return detail::assign_const_t<T, bool>{t, true}; }
+
+template <class T>
+inline auto assign_false(T &t) { return detail::assign_const_t<T, bool>{t, false}; }
+
+template <class T, class U>
+inline auto push_back_const(T &t, U &&u)
+{
+    return detail::push_back_const_t<T, std::decay_t<U>>{t, std::forward<U>(u)};
+}
+
+template <class T, class U>
+inline auto assign_or(T &t, U &&u)
+{
+    return detail::assign_or_t<T, std::decay_t<U>>{t, std::forward<U>(u)};
+}
+
+template <class T, class U>
+inline auto push_back_or(T &t, U &&u)
+{
+    return detail::push_back_or_t<T, std::decay_t<U>>{t, std::forward<U>(u)};
+}
+
+template <class T>
+inline auto assign(T &t)
+{
+    return detail::assign_t<T>{t};
+}
+
+template <class T>
+inline auto push_back(T &t)
+{
+    return detail::push_back_t<T>{t};
+}
+
+// Records the argument into a basic_lazy_value or basic_lazy_values.
+template <class Lazy>
+inline auto lazy(Lazy &l)
+{
+    return detail::lazy_t<Lazy>{l};
+}
+
+// The following take a pointer to a member of the context, e.g.
+// assign(&options::count).
+
+template <class R, class T, class U>
+inline auto assign_const(T R::*m, U &&u)
+{
+    return detail::member(m, [u = std::forward<U>(u)](T &t) { return assign_const(t, u); });
+}
+
+template <class R, class T>
+inline auto assign_true(T R::*m) { return assign_const(m, true); }
+
+template <class R, class T>
+inline auto assign_false(T R::*m) { return assign_const(m, false); }
+
+template <class R, class T, class U>
+inline auto push_back_const(T R::*m, U &&u)
+{
+    return detail::member(m, [u = std::forward<U>(u)](T &t) { return push_back_const(t, u); });
+}
+
+template <class R, class T, class U>
+inline auto assign_or(T R::*m, U &&u)
+{
+    return detail::member(m, [u = std::forward<U>(u)](T &t) { return assign_or(t, u); });
+}
+
+template <class R, class T, class U>
+inline auto push_back_or(T R::*m, U &&u)
+{
+    return detail::member(m, [u = std::forward<U>(u)](T &t) { return push_back_or(t, u); });
+}
+
+template <class R, class T>
+inline auto assign(T R::*m)
+{
+    return detail::member(m, [](T &t) { return assign(t); });
+}
+
+template <class R, class T>
+inline auto push_back(T R::*m)
+{
+    return detail::member(m, [](T &t) { return push_back(t); });
+}
+
+template <class R, class T>
+inline auto lazy(T R::*m)
+{
+    return detail::member(m, [](T &t) { return lazy(t); });
+}
+
+} // namespace getoptmm
+
+#endif